@@ -1,7 +1,7 @@
 import time
 import board
 import adafruit_dht
-from writeToDB import write
+from writeToDB import now_ns, write_fields
 from alert import telegram_bot_sendtext
 
 # initialize the dht11 device, with data pin connected to:
@@ -18,11 +18,12 @@ while True:
     try:
         # Write the values to InfluxDB
 
+        # both values come from the same reading, so they go out as one point stamped when it was taken
+        sampled = now_ns()
         temperature = dhtDevice.temperature
         humidity = dhtDevice.humidity
 
-        write("humid", humidity)
-        write("temp", temperature)
+        write_fields({"humid": humidity, "temp": temperature}, sampled)
     
         # Check if the temperature or humidity value exceeds threshold and if it does,
         # send a telegram text
@@ -1,76 +1,78 @@
 # Script that reads values from the CAJOE Geiger Counter
 
 import time
-import datetime
-import RPi.GPIO as GPIO
-from collections import deque
-from writeToDB import write
+import atexit
+import ctypes
+from writeToDB import write_fields, now_ns
+import pulses
 from alert import telegram_bot_sendtext
 
-# use GPIO.setmode(GPIO.BOARD) to use pin numbers
-GPIO.setmode(GPIO.BOARD)
-
-# use GPIO.setwarnings(False) to disable warnings
-GPIO.setwarnings(False)
-
-counts = deque()
-hundredcount = 0
-usvh_ratio = 0.00812037037037  # This is for the J305 tube
+hundreds = 0
 threshold = 2.00 # Set threshold for alert texts
 
-# This method fires on edge detection (the pulse from the counter board)
-
-
-def countme(channel):
-    global counts, hundredcount
-    timestamp = datetime.datetime.now()
-    counts.append(timestamp)
-
-    # Every time we hit 100 counts, run count100 and reset
-    hundredcount = hundredcount + 1
-    if hundredcount >= 100:
-        hundredcount = 0
-        count100()
-
-# This method runs the servo to increment the mechanical counter
-
+# The pulses from the counter board are captured natively (see "Pulse capture" in geigerpl/geiger.h), each with
+# the kernel's CLOCK_MONOTONIC timestamp of its falling edge, and counted as they come into 100 ms buckets
+# (see "Windowed counts"), so the count over any window up to an hour costs the same whatever the count rate.
+# Board pin 7 is GPIO4 on the first chip (/dev/gpiochip4 on a Pi 5).
+GPIO_CHIP = b"/dev/gpiochip0"
+PULSE_LINE = 4
+BUCKET_MS = 100
+WINDOW_MS = 60 * 60 * 1000
+counter = pulses.lib.geiger_counter_open(BUCKET_MS, WINDOW_MS)
+capture = pulses.lib.geiger_capture_open(GPIO_CHIP, PULSE_LINE, 0, 0)
+if not counter or not capture:
+    raise RuntimeError("could not capture pulses from GPIO line %d" % PULSE_LINE)
+pulses.lib.geiger_capture_count(capture, counter)
+# registered after the counter's close, so the capture stops feeding it first
+atexit.register(pulses.lib.geiger_counter_close, counter)
+atexit.register(pulses.lib.geiger_capture_close, capture)
+
+
+# The servo on board pin 12 increments the mechanical counter once every 100 counts. It is driven from a native
+# actuator thread (see "Actuator" in geigerpl/geiger.h), so neither counting nor this loop waits the 2 s a stroke takes,
+# and hundreds that come in while it moves are added to the strokes it still has to make.
+# Pin 12 is GPIO18, PWM channel 0 once "dtoverlay=pwm,pin=18,func=2" is in /boot/config.txt (pwmchip2 on a Pi 5).
+SERVO_PWM_CHIP = b"/sys/class/pwm/pwmchip0"
+SERVO_PWM_CHANNEL = 0
+actuator = pulses.lib.geiger_actuator_open(SERVO_PWM_CHIP, SERVO_PWM_CHANNEL, 800, 1900, 1000)  # 4% and 9.5% of 20 ms
+if not actuator:
+    print("could not drive the servo, the mechanical counter won't move")
+atexit.register(pulses.lib.geiger_actuator_close, actuator)
+
+
+def countme():
+    global hundreds
+
+    # Every time we hit another 100 counts, have the servo increment the mechanical counter
+    total = pulses.lib.geiger_counter_total(counter) // 100
+    if total > hundreds:
+        pulses.lib.geiger_actuator_advance(actuator, total - hundreds)
+        hundreds = total
 
-def count100():
-    GPIO.setup(12, GPIO.OUT)
-    pwm = GPIO.PWM(12, 50)
-
-    pwm.start(4)
-    time.sleep(1)
-    pwm.start(9.5)
-    time.sleep(1)
-    pwm.stop()
-
-
-# Set the input with falling edge detection for geiger counter pulses
-GPIO.setup(7, GPIO.IN)
-GPIO.add_event_detect(7, GPIO.FALLING, callback=countme)
 
 loop_count = 0
 
-# In order to calculate CPM we need to store a rolling count of events in the last 60 seconds
-# We then calculate the radiation in micro Sieverts per hour by multiplying it with a factor.
+# The dose rates over the last 10 s, 60 s, 10 min and 1 h come from the counter, corrected for the tube's dead time
+# and converted to micro Sieverts per hour with its factor (see "Dose rate" in geigerpl/geiger.h).
+TUBE = pulses.lib.geiger_tube_find(b"J305")  # or b"SBM-20", b"M4011"
+dose = pulses.Dose()
 
 while True:
     loop_count = loop_count + 1
-
-    try:
-        while counts[0] < datetime.datetime.now() - datetime.timedelta(seconds=60):
-            counts.popleft()
-    except IndexError:
-        pass  # there are no records in the queue.
+    countme()
 
     if loop_count == 10:
 
-        # Calculate the radiation in micro Sieverts per hour,
-        # write it to InfluxDB and reset the count
+        # Calculate the radiation in micro Sieverts per hour over every window,
+        # and write them to InfluxDB, with usvh over the last minute as before.
+        # Only usvh is rolled up: the other windows are averages already, and rolling them up as well would take
+        # more channels (with the geotag) than a rollup has
 
-        usvh = float("{:.2f}".format(len(counts)*usvh_ratio))
-        write("usvh", usvh)
+        sampled = now_ns()
+        pulses.lib.geiger_dose_rates(counter, TUBE, 0, ctypes.byref(dose))
+        usvh = float("{:.2f}".format(dose.usvh[1]))
+        write_fields({"usvh": usvh}, sampled)
+        write_fields({"usvh_10s": round(dose.usvh[0], 2), "usvh_10m": round(dose.usvh[2], 2), "usvh_1h": round(dose.usvh[3], 2)}, sampled, live=False)
 
         # Check if the usvh value exceeds threshold and if it does,
         # send a telegram text
@@ -80,7 +82,7 @@ while True:
             telegram_bot_sendtext(message)
 
         # print the measurements (if you need it)
-        print(f"{usvh} usvh")
+        print(f"{usvh} usvh" + (" (tube saturated)" if dose.saturated else ""))
 
         loop_count = 0
 
@@ -0,0 +1,153 @@
+/*
+   * Pulses the simulated line from ../sim/setup.sh and reports what the capture made of them, e.g.
+   *
+   *     sudo ./capture_bench -c /dev/gpiochip1 -o 0 -p /sys/devices/platform/gpio-sim.0/gpiochip1/sim_gpio0/pull -n 100000 -r 5000
+   *
+   * n pulses are driven at r per second (0 for as fast as possible) by pulling the line down and back up through
+   * its pull attribute, and the kernel timestamps read back from the ring are checked against the moment each pull
+   * was written: how many arrived, the edge-to-timestamp latency percentiles and the capture's counters.
+*/
+#include "../geiger.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint64_t now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int compare(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+	return (x > y) - (x < y);
+}
+
+static int pull(int fd, const char *direction)
+{
+	return pwrite(fd, direction, strlen(direction), 0) < 0 ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *chip = NULL;
+	unsigned offset = 0;
+	const char *pull_path = NULL;
+	unsigned n = 10000;
+	unsigned rate = 1000;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "c:o:p:n:r:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'c':
+			chip = optarg;
+			break;
+		case 'o':
+			offset = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 'p':
+			pull_path = optarg;
+			break;
+		case 'n':
+			n = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			rate = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s -c chip -o offset -p pull attribute [-n pulses] [-r pulses/s]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (chip == NULL || pull_path == NULL || n == 0)
+	{
+		fprintf(stderr, "usage: %s -c chip -o offset -p pull attribute [-n pulses] [-r pulses/s]\n", argv[0]);
+		return 1;
+	}
+
+	int fd = open(pull_path, O_WRONLY);
+	uint64_t *driven = malloc(n * sizeof(uint64_t));
+	uint64_t *captured = malloc(n * sizeof(uint64_t));
+	long long *latencies = malloc(n * sizeof(long long));
+	geiger_capture *capture = geiger_capture_open(chip, offset, 0, n);
+	if (fd < 0 || driven == NULL || captured == NULL || latencies == NULL || capture == NULL)
+	{
+		fprintf(stderr, "*** could not set up the capture on %s line %u, or open %s!\n", chip, offset, pull_path);
+		return 1;
+	}
+	pull(fd, "pull-up");
+	usleep(10000);
+
+	uint64_t started = now_ns();
+	for (unsigned i = 0; i < n; i++)
+	{
+		if (rate > 0)
+		{
+			uint64_t due = started + (uint64_t)(i * (1e9 / rate));
+			uint64_t now = now_ns();
+			if (due > now)
+			{
+				usleep((useconds_t)((due - now) / 1000));
+			}
+		}
+		driven[i] = now_ns();
+		if (pull(fd, "pull-down") < 0 || pull(fd, "pull-up") < 0)
+		{
+			perror("*** pull");
+			return 1;
+		}
+	}
+	double elapsed = (now_ns() - started) / 1e9;
+	usleep(100000);
+
+	unsigned m = 0;
+	while (m < n)
+	{
+		unsigned got = geiger_capture_read(capture, captured + m, n - m);
+		if (got == 0)
+		{
+			break;
+		}
+		m += got;
+	}
+
+	// a timestamp belongs to the latest pull written before it
+	unsigned k = 0, matched = 0;
+	for (unsigned i = 0; i < m; i++)
+	{
+		while (k + 1 < n && driven[k + 1] <= captured[i])
+		{
+			k++;
+		}
+		if (captured[i] >= driven[k])
+		{
+			latencies[matched++] = (long long)(captured[i] - driven[k]);
+		}
+	}
+	qsort(latencies, matched, sizeof(long long), compare);
+
+	geiger_capture_info info;
+	geiger_capture_status(capture, &info);
+	printf("driven     %u pulses in %.2f s (%.0f/s)\n", n, elapsed, n / elapsed);
+	printf("captured   %u (%s)\n", m, m == n ? "all" : "MISSING SOME");
+	if (matched > 0)
+	{
+		printf("stamped    p50 %8lld ns  p99 %8lld ns  max %8lld ns after the pull was written\n", latencies[matched / 2], latencies[(size_t)(matched * 0.99)], latencies[matched - 1]);
+	}
+	printf("capture    pulses %llu  read %llu  lost %llu  overrun %llu  batches %llu (%.1f events each)\n", info.pulses, info.read, info.lost, info.overrun, info.batches,
+	       info.batches > 0 ? (double)info.pulses / info.batches : 0);
+
+	geiger_capture_close(capture);
+	close(fd);
+	free(driven);
+	free(captured);
+	free(latencies);
+	return m == n ? 0 : 1;
+}
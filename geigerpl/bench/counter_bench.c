@@ -0,0 +1,123 @@
+/*
+   * Cost and accuracy of the windowed counter, on synthetic pulse trains, e.g.
+   *
+   *     ./counter_bench -s 3600 -r 20,2000,50000
+   *
+   * For each rate (pulses per second, Poisson distributed) s seconds of pulses are fed to a counter with 100 ms
+   * buckets, and once a simulated second the 10 s, 60 s, 10 min and 1 h counts are checked against an exact count
+   * over the timestamps themselves, reporting the cost per pulse and per query and the largest difference, which
+   * can only come from the window being rounded to whole buckets.
+*/
+#include "../geiger.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench(unsigned rate, unsigned seconds)
+{
+	static const unsigned windows[] = { 10000, 60000, 600000, 3600000 };
+	unsigned n = 0, capacity = rate * seconds + rate * seconds / 10 + 64;
+	uint64_t *timestamps = malloc(capacity * sizeof(uint64_t));
+	geiger_counter *counter = geiger_counter_open(100, 3600000);
+	if (timestamps == NULL || counter == NULL)
+	{
+		return;
+	}
+
+	// the counter measures from when it was opened, so the simulated pulses start then
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	uint64_t start = (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+	unsigned seed = 1;
+	double t = 0;
+	for (;;)
+	{
+		t += -log((rand_r(&seed) + 1.0) / (RAND_MAX + 2.0)) / rate;
+		if (t >= seconds || n == capacity)
+		{
+			break;
+		}
+		timestamps[n++] = start + (uint64_t)(t * 1e9);
+	}
+
+	double fed = 0, queried = 0;
+	unsigned queries = 0, i = 0;
+	unsigned long long worst[4] = { 0 };
+	unsigned long long exact[4];
+	unsigned oldest[4] = { 0 };
+	for (unsigned second = 1; second <= seconds; second++)
+	{
+		uint64_t now = start + second * 1000000000ull;
+		unsigned j = i;
+		while (j < n && timestamps[j] <= now)
+		{
+			j++;
+		}
+		double begin = now_ns();
+		geiger_counter_pulses(counter, timestamps + i, j - i);
+		fed += now_ns() - begin;
+		i = j;
+
+		for (unsigned w = 0; w < 4; w++)
+		{
+			uint64_t since = now > windows[w] * 1000000ull ? now - windows[w] * 1000000ull : 0;
+			while (oldest[w] < i && timestamps[oldest[w]] <= since)
+			{
+				oldest[w]++;
+			}
+			exact[w] = i - oldest[w];
+
+			begin = now_ns();
+			unsigned long long counted = geiger_counter_count(counter, now, windows[w]);
+			queried += now_ns() - begin;
+			queries++;
+			unsigned long long difference = counted > exact[w] ? counted - exact[w] : exact[w] - counted;
+			worst[w] = difference > worst[w] ? difference : worst[w];
+		}
+	}
+
+	printf("%6u/s  %9u pulses  %5.1f ns/pulse  %5.1f ns/query  largest difference 10 s %llu (%.2f%%)  60 s %llu  10 min %llu  1 h %llu  cpm over the last minute %.0f\n", rate, n, fed / n, queried / queries,
+	       worst[0], 100.0 * worst[0] / (rate * 10.0), worst[1], worst[2], worst[3], geiger_counter_cpm(counter, start + seconds * 1000000000ull, 60000));
+
+	geiger_counter_close(counter);
+	free(timestamps);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned seconds = 3600;
+	char rates[256] = "20,2000,50000";
+
+	int opt;
+	while ((opt = getopt(argc, argv, "s:r:")) != -1)
+	{
+		switch (opt)
+		{
+		case 's':
+			seconds = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			snprintf(rates, sizeof(rates), "%s", optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-s seconds] [-r rate,rate,...]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	for (char *rate = strtok(rates, ","); rate != NULL; rate = strtok(NULL, ","))
+	{
+		bench((unsigned)strtoul(rate, NULL, 10), seconds);
+	}
+	return 0;
+}
@@ -0,0 +1,104 @@
+/*
+   * How well the dead-time correction gets back to the true rate, on a simulated tube, e.g.
+   *
+   *     ./dose_bench -t SBM-20 -r 10,1000,3000,8000
+   *
+   * For each true rate (pulses per second, Poisson distributed) an hour of pulses goes through a non-paralyzable
+   * tube of the profile's dead time (a pulse within dead time of the last one counted is lost) into a counter,
+   * and the dose rates over every window are printed as counted and as corrected, next to the true CPM.
+*/
+#include "../geiger.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static void bench(const geiger_tube *tube, unsigned rate)
+{
+	geiger_counter *counter = geiger_counter_open(100, 60 * 60 * 1000);
+	if (counter == NULL)
+	{
+		return;
+	}
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	uint64_t start = (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+	uint64_t dead = (uint64_t)(tube->dead_time_us * 1000);
+	uint64_t counted = 0;
+	int any = 0;
+	unsigned seed = 1;
+	double t = 0;
+	uint64_t batch[GEIGER_BATCH];
+	unsigned n = 0;
+	for (;;)
+	{
+		t += -log((rand_r(&seed) + 1.0) / (RAND_MAX + 2.0)) / rate;
+		if (t >= 3600)
+		{
+			break;
+		}
+		uint64_t timestamp = start + (uint64_t)(t * 1e9);
+		if (any && timestamp - counted < dead)
+		{
+			continue;
+		}
+		any = 1;
+		counted = timestamp;
+		batch[n++] = timestamp;
+		if (n == GEIGER_BATCH)
+		{
+			geiger_counter_pulses(counter, batch, n);
+			n = 0;
+		}
+	}
+	geiger_counter_pulses(counter, batch, n);
+
+	geiger_dose dose;
+	geiger_dose_rates(counter, tube, start + 3600 * 1000000000ull, &dose);
+	printf("%-7s true %8.0f cpm", tube->name, rate * 60.0);
+	for (unsigned w = 0; w < GEIGER_DOSE_WINDOWS; w++)
+	{
+		printf("  |  %4us: counted %8.0f corrected %8.0f cpm (%+5.1f%%) %7.3f uSv/h +-%.1f%%%s", geiger_dose_windows_ms[w] / 1000, dose.cpm[w], dose.corrected_cpm[w],
+		       100 * (dose.corrected_cpm[w] / (rate * 60.0) - 1), dose.usvh[w], 100 * dose.error[w], dose.saturated >> w & 1 ? " SATURATED" : "");
+	}
+	printf("\n");
+	geiger_counter_close(counter);
+}
+
+int main(int argc, char **argv)
+{
+	const char *name = "J305";
+	char rates[256] = "10,1000,3000,8000";
+
+	int opt;
+	while ((opt = getopt(argc, argv, "t:r:")) != -1)
+	{
+		switch (opt)
+		{
+		case 't':
+			name = optarg;
+			break;
+		case 'r':
+			snprintf(rates, sizeof(rates), "%s", optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-t J305|SBM-20|M4011] [-r rate,rate,...]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	const geiger_tube *tube = geiger_tube_find(name);
+	if (tube == NULL)
+	{
+		fprintf(stderr, "*** no profile for a %s tube!\n", name);
+		return 1;
+	}
+	for (char *rate = strtok(rates, ","); rate != NULL; rate = strtok(NULL, ","))
+	{
+		bench(tube, (unsigned)strtoul(rate, NULL, 10));
+	}
+	return 0;
+}
@@ -0,0 +1,15 @@
+# build capture_bench, along with its own libgeiger.so
+#
+# run it against the simulated chip from ../sim/setup.sh, e.g.
+#   sudo ./capture_bench -c /dev/gpiochip1 -o 0 -p /sys/devices/platform/gpio-sim.0/gpiochip1/sim_gpio0/pull -n 100000 -r 5000
+
+cd "$(dirname "$0")"
+
+gcc -O2 -fPIC -shared -o libgeiger.so ../geiger_*.c -lpthread -lm
+gcc -O2 -o capture_bench capture_bench.c -L. -lgeiger -Wl,-rpath,'$ORIGIN'
+
+# counter_bench reports what the windowed counter costs and how close it counts, e.g. ./counter_bench -s 3600 -r 20,2000,50000
+gcc -O2 -o counter_bench counter_bench.c -L. -lgeiger -lm -Wl,-rpath,'$ORIGIN'
+
+# dose_bench reports how close the dead-time corrected dose rates get to a simulated tube's true rate, e.g. ./dose_bench -t SBM-20
+gcc -O2 -o dose_bench dose_bench.c -L. -lgeiger -lm -Wl,-rpath,'$ORIGIN'
@@ -0,0 +1,141 @@
+#ifndef _GEIGER_H_
+#define _GEIGER_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   * Pulse capture.
+   * The tube's pulses are taken from the Linux GPIO character device (the v2 uapi in linux/gpio.h, which is what
+   * libgpiod wraps) rather than through a Python callback per pulse: the line is requested with falling edge
+   * detection, and a capture thread reads the kernel's edge events in batches of up to GEIGER_BATCH, each stamped by
+   * the kernel in CLOCK_MONOTONIC nanoseconds when the edge happened, not when anything got round to it.
+   * The timestamps go into a ring of ring_size (rounded up to a power of two) uint64_t allocated at open, which
+   * one consumer drains with geiger_capture_read() (0 for no ring, when a counter takes care of them); nothing is
+   * allocated per pulse.
+   *
+   * Pulses are never silently lost: edges the kernel dropped because its event FIFO overflowed show up as gaps in
+   * the line's sequence numbers and are counted in lost, pulses that found the ring full in overrun.
+   * With debounce_us, the kernel ignores edges closer together than that (0 for none; anything much under the
+   * tube's dead time, ~100 us for a J305, can't be a second count anyway).
+   *
+   * geiger_capture_attach() takes a line already requested with edge detection instead, e.g. from libgpiod's
+   * gpiod_line_request_get_fd(), and closes it along with the capture.
+   * On a machine without the GPIO header, see geigerpl/sim/setup.sh for a simulated chip to capture from.
+*/
+#define GEIGER_BATCH 64
+
+typedef struct geiger_capture geiger_capture;
+typedef struct geiger_counter geiger_counter;
+
+typedef struct
+{
+	unsigned long long pulses;  // captured
+	unsigned long long read;    // taken out of it
+	unsigned long long lost;    // dropped by the kernel
+	unsigned long long overrun; // dropped with the ring full
+	unsigned long long batches; // reads of the line
+	unsigned backlog;           // in the ring
+} geiger_capture_info;
+
+geiger_capture *geiger_capture_open(const char *chip, unsigned offset, unsigned debounce_us, unsigned ring_size);
+geiger_capture *geiger_capture_attach(int fd, unsigned ring_size);
+void geiger_capture_count(geiger_capture *capture, geiger_counter *counter);
+unsigned geiger_capture_read(geiger_capture *capture, uint64_t *timestamps, unsigned max);
+void geiger_capture_status(geiger_capture *capture, geiger_capture_info *info);
+void geiger_capture_close(geiger_capture *capture);
+
+/*
+   * Windowed counts.
+   * A counter keeps the running total of pulses at the end of each bucket_ms, in a circular array of as many
+   * buckets as window_ms (the longest window it answers for) takes, so the pulses over any window up to that are
+   * the total now less the total at the end of the bucket the window starts after: O(1) per pulse and per query,
+   * and memory fixed at open whatever the count rate. Windows are in whole buckets, the one now is in counting
+   * as a whole; geiger_counter_cpm() divides by the time they actually cover (and no more than since open),
+   * so a 60 s window with 100 ms buckets is a rate over 59.9 to 60 s that doesn't dip as a bucket starts.
+   *
+   * Timestamps are CLOCK_MONOTONIC ns, as the capture stamps them, with now 0 for the current time.
+   * geiger_capture_count() has the capture thread feed a counter every batch it reads, before and whether or not
+   * anyone drains the ring; counters are thread safe. Close the capture (or set NULL) before the counter it feeds.
+*/
+geiger_counter *geiger_counter_open(unsigned bucket_ms, unsigned window_ms);
+void geiger_counter_pulses(geiger_counter *counter, const uint64_t *timestamps, unsigned n);
+unsigned long long geiger_counter_count(geiger_counter *counter, uint64_t now, unsigned window_ms);
+double geiger_counter_cpm(geiger_counter *counter, uint64_t now, unsigned window_ms);
+unsigned long long geiger_counter_total(geiger_counter *counter);
+void geiger_counter_close(geiger_counter *counter);
+
+/*
+   * Actuator.
+   * The servo that pushes the mechanical counter on is driven from a thread of its own, through the kernel's PWM
+   * sysfs interface (chip e.g. /sys/class/pwm/pwmchip0, whose channel is exported at open and unexported at close),
+   * so counting never waits for it: geiger_actuator_advance() only adds n strokes to the pending count and returns.
+   * A stroke sets a 50 Hz pulse of first_us, holds it hold_ms, then second_us for another hold_ms, and the PWM is
+   * switched off once nothing is pending. Increments that come in while the servo moves are coalesced into the
+   * pending count rather than queued one by one, so the queue is one number however far behind the servo falls.
+   * Close finishes the stroke under way and drops whatever is still pending.
+*/
+#define GEIGER_SERVO_PERIOD_US 20000
+
+typedef struct geiger_actuator geiger_actuator;
+
+typedef struct
+{
+	unsigned long requested; // strokes asked for
+	unsigned long strokes;   // made
+	unsigned long coalesced; // requests that added to strokes already pending
+	unsigned long failures;  // strokes or switch-offs the PWM didn't take
+	unsigned long pending;
+} geiger_actuator_info;
+
+geiger_actuator *geiger_actuator_open(const char *chip, unsigned channel, unsigned first_us, unsigned second_us, unsigned hold_ms);
+void geiger_actuator_advance(geiger_actuator *actuator, unsigned n);
+void geiger_actuator_status(geiger_actuator *actuator, geiger_actuator_info *info);
+void geiger_actuator_close(geiger_actuator *actuator);
+
+/*
+   * Dose rate.
+   * geiger_dose_rates() reads a counter (which has to keep at least an hour) over 10 s, 60 s, 10 min and 1 h,
+   * in O(1) each, and turns the counts into dose rates for a tube from the compile-time profiles in geiger_tubes:
+   * the measured CPM is corrected for the tube's dead time as a non-paralyzable counter, n = m / (1 - m tau), then
+   * multiplied by its uSv/h per CPM. error is the relative 1 sigma of the count (1 / sqrt(counts)), so the short
+   * windows answer fast and the long ones precisely. A window where the tube was dead 95% of the time or more is
+   * flagged in saturated (bit w) and its correction capped there, as the real rate could be anything past it.
+   *
+   * Windows shorter than their length since the counter was opened are over the time there was (minutes).
+*/
+#define GEIGER_DOSE_WINDOWS 4
+#define GEIGER_TUBES 3
+
+typedef struct
+{
+	const char *name;
+	double usvh_per_cpm;
+	double dead_time_us;
+} geiger_tube;
+
+typedef struct
+{
+	unsigned long long counts[GEIGER_DOSE_WINDOWS];
+	double minutes[GEIGER_DOSE_WINDOWS];
+	double cpm[GEIGER_DOSE_WINDOWS];           // as counted
+	double corrected_cpm[GEIGER_DOSE_WINDOWS]; // for dead time
+	double usvh[GEIGER_DOSE_WINDOWS];
+	double error[GEIGER_DOSE_WINDOWS];
+	unsigned saturated;
+} geiger_dose;
+
+extern const unsigned geiger_dose_windows_ms[GEIGER_DOSE_WINDOWS];
+extern const geiger_tube geiger_tubes[GEIGER_TUBES]; // J305, SBM-20, M4011
+
+const geiger_tube *geiger_tube_find(const char *name);
+void geiger_dose_rates(geiger_counter *counter, const geiger_tube *tube, uint64_t now, geiger_dose *dose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
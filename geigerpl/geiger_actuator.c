@@ -0,0 +1,255 @@
+#include "./geiger.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PATH_MAX_LENGTH 256
+
+struct geiger_actuator
+{
+	char chip[PATH_MAX_LENGTH];
+	unsigned channel;
+	int duty_fd;
+	int enable_fd;
+	unsigned first_ns; // pulse widths of the two halves of a stroke
+	unsigned second_ns;
+	unsigned hold_ms;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	int initialized; // lock and wake
+	int started;     // thread
+	int stop;
+	geiger_actuator_info info; // pending is the command queue, strokes coalesce into it
+};
+
+static int write_attribute(const char *path, unsigned long value)
+{
+	char text[32];
+	int length = snprintf(text, sizeof(text), "%lu", value);
+	int fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		return -1;
+	}
+	int rc = write(fd, text, (size_t)length) == length ? 0 : -1;
+	close(fd);
+	return rc;
+}
+
+static int set(int fd, unsigned long value)
+{
+	char text[32];
+	int length = snprintf(text, sizeof(text), "%lu", value);
+	return pwrite(fd, text, (size_t)length, 0) == length ? 0 : -1;
+}
+
+static void hold(unsigned ms)
+{
+	struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000 };
+	while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+	{
+	}
+}
+
+// one push and release of the mechanical counter, as count100() did it with RPi.GPIO
+static int stroke(geiger_actuator *actuator)
+{
+	if (set(actuator->duty_fd, actuator->first_ns) < 0 || set(actuator->enable_fd, 1) < 0)
+	{
+		return -1;
+	}
+	hold(actuator->hold_ms);
+	if (set(actuator->duty_fd, actuator->second_ns) < 0)
+	{
+		return -1;
+	}
+	hold(actuator->hold_ms);
+	return 0;
+}
+
+static void *actuator_thread(void *arg)
+{
+	geiger_actuator *actuator = arg;
+
+	pthread_mutex_lock(&actuator->lock);
+	for (;;)
+	{
+		while (actuator->info.pending == 0 && !actuator->stop)
+		{
+			pthread_cond_wait(&actuator->wake, &actuator->lock);
+		}
+		if (actuator->stop)
+		{
+			break;
+		}
+
+		// strokes are taken off one at a time, so increments coming in meanwhile just add to the pending count
+		actuator->info.pending--;
+		pthread_mutex_unlock(&actuator->lock);
+		int rc = stroke(actuator);
+		pthread_mutex_lock(&actuator->lock);
+		if (rc < 0)
+		{
+			actuator->info.failures++;
+		}
+		else
+		{
+			actuator->info.strokes++;
+		}
+
+		// idle with the PWM off, as pwm.stop() did, so the servo doesn't hum between strokes
+		if (actuator->info.pending == 0 && set(actuator->enable_fd, 0) < 0)
+		{
+			actuator->info.failures++;
+		}
+	}
+	pthread_mutex_unlock(&actuator->lock);
+	return NULL;
+}
+
+static int open_attribute(geiger_actuator *actuator, const char *name)
+{
+	char path[PATH_MAX_LENGTH + 64];
+	snprintf(path, sizeof(path), "%s/pwm%u/%s", actuator->chip, actuator->channel, name);
+
+	// the attributes show up (and udev makes them writable) a moment after the export
+	for (int attempt = 0; attempt < 100; attempt++)
+	{
+		int fd = open(path, O_WRONLY | O_CLOEXEC);
+		if (fd >= 0 || (errno != ENOENT && errno != EACCES))
+		{
+			return fd;
+		}
+		hold(10);
+	}
+	return -1;
+}
+
+geiger_actuator *geiger_actuator_open(const char *chip, unsigned channel, unsigned first_us, unsigned second_us, unsigned hold_ms)
+{
+	if (chip == NULL || strlen(chip) >= PATH_MAX_LENGTH || first_us >= GEIGER_SERVO_PERIOD_US || second_us >= GEIGER_SERVO_PERIOD_US)
+	{
+		return NULL;
+	}
+
+	geiger_actuator *actuator = calloc(1, sizeof(*actuator));
+	if (actuator == NULL)
+	{
+		return NULL;
+	}
+	actuator->duty_fd = -1;
+	actuator->enable_fd = -1;
+	snprintf(actuator->chip, sizeof(actuator->chip), "%s", chip);
+	actuator->channel = channel;
+	actuator->first_ns = first_us * 1000;
+	actuator->second_ns = second_us * 1000;
+	actuator->hold_ms = hold_ms;
+
+	// exporting a channel that already is fails with EBUSY, which is fine
+	char path[PATH_MAX_LENGTH + 64];
+	snprintf(path, sizeof(path), "%s/export", chip);
+	if (write_attribute(path, channel) < 0 && errno != EBUSY)
+	{
+		perror("*** geiger actuator export");
+		free(actuator);
+		return NULL;
+	}
+
+	int period_fd = open_attribute(actuator, "period");
+	actuator->duty_fd = open_attribute(actuator, "duty_cycle");
+	actuator->enable_fd = open_attribute(actuator, "enable");
+	if (period_fd < 0 || actuator->duty_fd < 0 || actuator->enable_fd < 0 || set(actuator->enable_fd, 0) < 0 || set(period_fd, GEIGER_SERVO_PERIOD_US * 1000ul) < 0)
+	{
+		perror("*** geiger actuator pwm");
+		geiger_actuator_close(actuator);
+		if (period_fd >= 0)
+		{
+			close(period_fd);
+		}
+		return NULL;
+	}
+	close(period_fd);
+
+	pthread_mutex_init(&actuator->lock, NULL);
+	pthread_cond_init(&actuator->wake, NULL);
+	actuator->initialized = 1;
+	if (pthread_create(&actuator->thread, NULL, actuator_thread, actuator) != 0)
+	{
+		fprintf(stderr, "*** geiger actuator failed: no thread!\n");
+		geiger_actuator_close(actuator);
+		return NULL;
+	}
+	actuator->started = 1;
+	return actuator;
+}
+
+void geiger_actuator_advance(geiger_actuator *actuator, unsigned n)
+{
+	if (actuator == NULL || n == 0)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&actuator->lock);
+	actuator->info.requested += n;
+	actuator->info.coalesced += actuator->info.pending > 0 ? 1 : 0;
+	actuator->info.pending += n;
+	pthread_cond_signal(&actuator->wake);
+	pthread_mutex_unlock(&actuator->lock);
+}
+
+void geiger_actuator_status(geiger_actuator *actuator, geiger_actuator_info *info)
+{
+	memset(info, 0, sizeof(*info));
+	if (actuator == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&actuator->lock);
+	*info = actuator->info;
+	pthread_mutex_unlock(&actuator->lock);
+}
+
+void geiger_actuator_close(geiger_actuator *actuator)
+{
+	if (actuator == NULL)
+	{
+		return;
+	}
+
+	if (actuator->started)
+	{
+		pthread_mutex_lock(&actuator->lock);
+		actuator->stop = 1;
+		pthread_cond_signal(&actuator->wake);
+		pthread_mutex_unlock(&actuator->lock);
+		pthread_join(actuator->thread, NULL);
+	}
+	if (actuator->initialized)
+	{
+		pthread_cond_destroy(&actuator->wake);
+		pthread_mutex_destroy(&actuator->lock);
+	}
+
+	if (actuator->enable_fd >= 0)
+	{
+		set(actuator->enable_fd, 0);
+		close(actuator->enable_fd);
+	}
+	if (actuator->duty_fd >= 0)
+	{
+		close(actuator->duty_fd);
+	}
+	char path[PATH_MAX_LENGTH + 64];
+	snprintf(path, sizeof(path), "%s/unexport", actuator->chip);
+	write_attribute(path, actuator->channel);
+	free(actuator);
+}
@@ -0,0 +1,281 @@
+#include "./geiger.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+// the most the kernel keeps queued for a line, 16 events for each of GPIO_V2_LINES_MAX
+#define KERNEL_EVENTS (16 * GPIO_V2_LINES_MAX)
+
+struct geiger_capture
+{
+	int fd;      // the requested line
+	int stop_fd; // eventfd, readable once the capture thread should exit
+	pthread_t thread;
+	_Atomic(geiger_counter *) counter; // fed every batch, if set
+
+	// single-producer (the capture thread) / single-consumer ring of timestamps, NULL for none
+	uint64_t *ring;
+	unsigned long mask;
+	_Atomic unsigned long head;
+	_Atomic unsigned long tail;
+	pthread_mutex_t reader; // serializes consumers
+
+	int sequenced; // whether line_seqno has been seen yet
+	unsigned last_seqno;
+	_Atomic unsigned long long pulses;
+	_Atomic unsigned long long lost;
+	_Atomic unsigned long long overrun;
+	_Atomic unsigned long long batches;
+};
+
+static void capture_event(geiger_capture *capture, const struct gpio_v2_line_event *event)
+{
+	// the line's sequence number counts every edge the kernel saw, including those that didn't fit its FIFO
+	if (capture->sequenced && event->line_seqno - capture->last_seqno > 1)
+	{
+		atomic_fetch_add_explicit(&capture->lost, event->line_seqno - capture->last_seqno - 1, memory_order_relaxed);
+	}
+	capture->sequenced = 1;
+	capture->last_seqno = event->line_seqno;
+	atomic_fetch_add_explicit(&capture->pulses, 1, memory_order_relaxed);
+	if (capture->ring == NULL)
+	{
+		return;
+	}
+
+	unsigned long head = atomic_load_explicit(&capture->head, memory_order_relaxed);
+	unsigned long tail = atomic_load_explicit(&capture->tail, memory_order_acquire);
+	if (head - tail > capture->mask)
+	{
+		atomic_fetch_add_explicit(&capture->overrun, 1, memory_order_relaxed);
+		return;
+	}
+	capture->ring[head & capture->mask] = event->timestamp_ns;
+	atomic_store_explicit(&capture->head, head + 1, memory_order_release);
+}
+
+static void *capture_thread(void *arg)
+{
+	geiger_capture *capture = arg;
+	struct gpio_v2_line_event events[GEIGER_BATCH];
+	size_t have = 0; // bytes of a partial event left from the last read, which a real line never leaves
+
+	for (;;)
+	{
+		struct pollfd fds[2] = { { capture->fd, POLLIN, 0 }, { capture->stop_fd, POLLIN, 0 } };
+		if (poll(fds, 2, -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			perror("*** geiger capture poll");
+			break;
+		}
+		if (fds[1].revents != 0)
+		{
+			break;
+		}
+		if ((fds[0].revents & (POLLERR | POLLNVAL)) != 0)
+		{
+			fprintf(stderr, "*** geiger capture failed: the line went away!\n");
+			break;
+		}
+
+		ssize_t length = read(capture->fd, (char *)events + have, sizeof(events) - have);
+		if (length < 0)
+		{
+			if (errno == EINTR || errno == EAGAIN)
+			{
+				continue;
+			}
+			perror("*** geiger capture read");
+			break;
+		}
+		if (length == 0)
+		{
+			break;
+		}
+
+		have += (size_t)length;
+		unsigned n = (unsigned)(have / sizeof(events[0]));
+		uint64_t timestamps[GEIGER_BATCH];
+		for (unsigned i = 0; i < n; i++)
+		{
+			capture_event(capture, &events[i]);
+			timestamps[i] = events[i].timestamp_ns;
+		}
+		geiger_counter_pulses(atomic_load_explicit(&capture->counter, memory_order_acquire), timestamps, n);
+		have -= n * sizeof(events[0]);
+		memmove(events, (char *)events + n * sizeof(events[0]), have);
+		atomic_fetch_add_explicit(&capture->batches, 1, memory_order_relaxed);
+	}
+	return NULL;
+}
+
+geiger_capture *geiger_capture_attach(int fd, unsigned ring_size)
+{
+	if (fd < 0 || ring_size > 1u << 30)
+	{
+		return NULL;
+	}
+
+	geiger_capture *capture = calloc(1, sizeof(*capture));
+	unsigned long size = 1;
+	while (size < ring_size)
+	{
+		size <<= 1;
+	}
+	uint64_t *ring = ring_size > 0 ? calloc(size, sizeof(uint64_t)) : NULL;
+	if (capture == NULL || (ring_size > 0 && ring == NULL))
+	{
+		free(capture);
+		free(ring);
+		return NULL;
+	}
+	capture->fd = fd;
+	capture->ring = ring;
+	capture->mask = size - 1;
+
+	capture->stop_fd = eventfd(0, EFD_CLOEXEC);
+	if (capture->stop_fd < 0)
+	{
+		perror("*** geiger capture eventfd");
+		free(ring);
+		free(capture);
+		return NULL;
+	}
+	pthread_mutex_init(&capture->reader, NULL);
+	if (pthread_create(&capture->thread, NULL, capture_thread, capture) != 0)
+	{
+		fprintf(stderr, "*** geiger capture failed: no thread!\n");
+		pthread_mutex_destroy(&capture->reader);
+		close(capture->stop_fd);
+		free(ring);
+		free(capture);
+		return NULL;
+	}
+	return capture;
+}
+
+geiger_capture *geiger_capture_open(const char *chip, unsigned offset, unsigned debounce_us, unsigned ring_size)
+{
+	if (chip == NULL)
+	{
+		return NULL;
+	}
+
+	int chip_fd = open(chip, O_RDWR | O_CLOEXEC);
+	if (chip_fd < 0)
+	{
+		perror("*** geiger capture open");
+		return NULL;
+	}
+
+	struct gpio_v2_line_request request;
+	memset(&request, 0, sizeof(request));
+	request.offsets[0] = offset;
+	request.num_lines = 1;
+	request.event_buffer_size = KERNEL_EVENTS;
+	snprintf(request.consumer, sizeof(request.consumer), "geiger");
+	// edges are stamped from CLOCK_MONOTONIC, the default event clock
+	request.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+	if (debounce_us > 0)
+	{
+		request.config.num_attrs = 1;
+		request.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_DEBOUNCE;
+		request.config.attrs[0].attr.debounce_period_us = debounce_us;
+		request.config.attrs[0].mask = 1;
+	}
+
+	int rc = ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &request);
+	close(chip_fd);
+	if (rc < 0)
+	{
+		perror("*** geiger capture line request");
+		return NULL;
+	}
+
+	geiger_capture *capture = geiger_capture_attach(request.fd, ring_size);
+	if (capture == NULL)
+	{
+		close(request.fd);
+	}
+	return capture;
+}
+
+unsigned geiger_capture_read(geiger_capture *capture, uint64_t *timestamps, unsigned max)
+{
+	if (capture == NULL || capture->ring == NULL || timestamps == NULL)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&capture->reader);
+	unsigned long tail = atomic_load_explicit(&capture->tail, memory_order_relaxed);
+	unsigned long head = atomic_load_explicit(&capture->head, memory_order_acquire);
+	unsigned n = head - tail < max ? (unsigned)(head - tail) : max;
+	for (unsigned i = 0; i < n; i++)
+	{
+		timestamps[i] = capture->ring[(tail + i) & capture->mask];
+	}
+	atomic_store_explicit(&capture->tail, tail + n, memory_order_release);
+	pthread_mutex_unlock(&capture->reader);
+	return n;
+}
+
+void geiger_capture_count(geiger_capture *capture, geiger_counter *counter)
+{
+	if (capture != NULL)
+	{
+		atomic_store_explicit(&capture->counter, counter, memory_order_release);
+	}
+}
+
+void geiger_capture_status(geiger_capture *capture, geiger_capture_info *info)
+{
+	memset(info, 0, sizeof(*info));
+	if (capture == NULL)
+	{
+		return;
+	}
+
+	unsigned long tail = atomic_load_explicit(&capture->tail, memory_order_acquire);
+	unsigned long head = atomic_load_explicit(&capture->head, memory_order_acquire);
+	info->pulses = atomic_load_explicit(&capture->pulses, memory_order_relaxed);
+	info->read = tail;
+	info->lost = atomic_load_explicit(&capture->lost, memory_order_relaxed);
+	info->overrun = atomic_load_explicit(&capture->overrun, memory_order_relaxed);
+	info->batches = atomic_load_explicit(&capture->batches, memory_order_relaxed);
+	info->backlog = (unsigned)(head - tail);
+}
+
+void geiger_capture_close(geiger_capture *capture)
+{
+	if (capture == NULL)
+	{
+		return;
+	}
+
+	uint64_t one = 1;
+	if (write(capture->stop_fd, &one, sizeof(one)) < 0)
+	{
+		perror("*** geiger capture eventfd");
+	}
+	pthread_join(capture->thread, NULL);
+
+	close(capture->stop_fd);
+	close(capture->fd);
+	pthread_mutex_destroy(&capture->reader);
+	free(capture->ring);
+	free(capture);
+}
@@ -0,0 +1,156 @@
+#include "./geiger_internal.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct geiger_counter
+{
+	pthread_mutex_t lock;
+	uint64_t bucket_ns;
+	unsigned buckets;
+	uint64_t started; // CLOCK_MONOTONIC ns at open, windows reaching further back are cut short
+	uint64_t current; // bucket of the latest pulse, counted from the epoch of CLOCK_MONOTONIC
+	unsigned long long total;
+	unsigned long long *ends; // ends[b % buckets] is the total at the end of bucket b, for the last buckets of them
+};
+
+static uint64_t monotonic_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+geiger_counter *geiger_counter_open(unsigned bucket_ms, unsigned window_ms)
+{
+	if (bucket_ms == 0 || window_ms < bucket_ms || window_ms / bucket_ms > 1u << 24)
+	{
+		return NULL;
+	}
+
+	geiger_counter *counter = calloc(1, sizeof(*counter));
+	if (counter == NULL)
+	{
+		return NULL;
+	}
+	counter->bucket_ns = bucket_ms * 1000000ull;
+	counter->buckets = window_ms / bucket_ms + 1;
+	counter->ends = calloc(counter->buckets, sizeof(unsigned long long));
+	if (counter->ends == NULL)
+	{
+		free(counter);
+		return NULL;
+	}
+	counter->started = monotonic_ns();
+	counter->current = counter->started / counter->bucket_ns;
+	pthread_mutex_init(&counter->lock, NULL);
+	return counter;
+}
+
+// move the latest bucket up to b, the buckets skipped over end with the total as it is
+static void advance(geiger_counter *counter, uint64_t b)
+{
+	if (b <= counter->current)
+	{
+		return;
+	}
+	uint64_t from = b - counter->current > counter->buckets ? b - counter->buckets : counter->current;
+	for (uint64_t k = from + 1; k <= b; k++)
+	{
+		counter->ends[k % counter->buckets] = counter->total;
+	}
+	counter->current = b;
+}
+
+void geiger_counter_pulses(geiger_counter *counter, const uint64_t *timestamps, unsigned n)
+{
+	if (counter == NULL || n == 0)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&counter->lock);
+	for (unsigned i = 0; i < n; i++)
+	{
+		// a pulse stamped before the latest one (there shouldn't be any) counts towards the latest bucket
+		advance(counter, timestamps[i] / counter->bucket_ns);
+		counter->total++;
+		counter->ends[counter->current % counter->buckets] = counter->total;
+	}
+	pthread_mutex_unlock(&counter->lock);
+}
+
+// pulses over the last window_ms as of now, in whole buckets with the one now is in counting as a whole;
+// from is set to when the oldest of them began
+static unsigned long long count(geiger_counter *counter, uint64_t now, unsigned window_ms, uint64_t *from)
+{
+	pthread_mutex_lock(&counter->lock);
+	advance(counter, now / counter->bucket_ns);
+	uint64_t span = window_ms * 1000000ull / counter->bucket_ns;
+	span = span < 1 ? 1 : span < counter->buckets - 1 ? span : counter->buckets - 1;
+	unsigned long long pulses = counter->total;
+	*from = 0;
+	if (counter->current >= span) // or less than span buckets since boot
+	{
+		pulses -= counter->ends[(counter->current - span) % counter->buckets];
+		*from = (counter->current - span + 1) * counter->bucket_ns;
+	}
+	pthread_mutex_unlock(&counter->lock);
+	return pulses;
+}
+
+unsigned long long geiger_counter_count(geiger_counter *counter, uint64_t now, unsigned window_ms)
+{
+	uint64_t from;
+	return counter == NULL ? 0 : count(counter, now == 0 ? monotonic_ns() : now, window_ms, &from);
+}
+
+unsigned long long geiger_counter_window(geiger_counter *counter, uint64_t now, unsigned window_ms, double *minutes)
+{
+	now = now == 0 ? monotonic_ns() : now;
+
+	// over the time the buckets counted actually cover, which only starts at open
+	uint64_t from;
+	unsigned long long pulses = count(counter, now, window_ms, &from);
+	from = from > counter->started ? from : counter->started;
+	*minutes = now > from ? (now - from) / 6e10 : 0;
+	return pulses;
+}
+
+double geiger_counter_cpm(geiger_counter *counter, uint64_t now, unsigned window_ms)
+{
+	if (counter == NULL)
+	{
+		return 0;
+	}
+
+	double minutes;
+	unsigned long long pulses = geiger_counter_window(counter, now, window_ms, &minutes);
+	return minutes > 0 ? pulses / minutes : 0;
+}
+
+unsigned long long geiger_counter_total(geiger_counter *counter)
+{
+	if (counter == NULL)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&counter->lock);
+	unsigned long long total = counter->total;
+	pthread_mutex_unlock(&counter->lock);
+	return total;
+}
+
+void geiger_counter_close(geiger_counter *counter)
+{
+	if (counter == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_destroy(&counter->lock);
+	free(counter->ends);
+	free(counter);
+}
@@ -0,0 +1,9 @@
+#ifndef _GEIGER_INTERNAL_H_
+#define _GEIGER_INTERNAL_H_
+
+#include "./geiger.h"
+
+// pulses over the last window_ms as of now (0 for the current time), and the minutes they were counted over
+unsigned long long geiger_counter_window(geiger_counter *counter, uint64_t now, unsigned window_ms, double *minutes);
+
+#endif // _GEIGER_INTERNAL_H_
@@ -0,0 +1,3 @@
+# compile and generate libgeiger.so, the native pulse capture geiger.py uses through pulses.py
+
+gcc -O2 -fPIC -shared -o libgeiger.so geiger_*.c -lpthread -lm
@@ -0,0 +1,30 @@
+# set up a simulated GPIO chip with the gpio-sim kernel module (Linux 5.17+, CONFIG_GPIO_SIM), so the pulse capture
+# can be run and measured on any machine, e.g. an x86 laptop; run as root
+#
+#   sudo sh geigerpl/sim/setup.sh          prints the chip and the line's pull attribute, which capture_bench drives
+#   sudo sh geigerpl/sim/setup.sh remove   takes it down again
+
+SIM=/sys/kernel/config/gpio-sim/geiger
+
+if [ "$1" = "remove" ]; then
+	echo 0 > $SIM/live
+	rmdir $SIM/bank0 $SIM
+	exit 0
+fi
+
+modprobe gpio-sim || exit 1
+mountpoint -q /sys/kernel/config || mount -t configfs none /sys/kernel/config
+
+mkdir -p $SIM/bank0
+echo 8 > $SIM/bank0/num_lines
+echo geiger > $SIM/bank0/label
+echo 1 > $SIM/live
+
+# line 0 idles high like the counter board's output, each pulse pulls it low
+DEVICE=$(cat $SIM/dev_name)
+CHIP=$(cat $SIM/bank0/chip_name)
+echo pull-up > /sys/devices/platform/$DEVICE/$CHIP/sim_gpio0/pull
+
+echo "chip /dev/$CHIP line 0"
+echo "pull /sys/devices/platform/$DEVICE/$CHIP/sim_gpio0/pull"
+echo "e.g. geigerpl/bench/capture_bench -c /dev/$CHIP -o 0 -p /sys/devices/platform/$DEVICE/$CHIP/sim_gpio0/pull"
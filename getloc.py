@@ -0,0 +1,164 @@
+# ctypes bindings for the shared library generated by skyhookpl/getlocation.c
+
+import ctypes
+
+FIX_VERSION = 1
+
+SOURCE_WIFI = 0
+SOURCE_OFFLINE = 1
+SOURCE_IP = 2
+SOURCE_LAST_KNOWN = 3
+
+# getloc_class and getloc_breaker_state values, see skyhookpl/getlocation.h
+CLASS_TRANSIENT = 0
+CLASS_ENVIRONMENT = 1
+CLASS_FATAL = 2
+BREAKER_CLOSED = 0
+BREAKER_OPEN = 1
+BREAKER_HALF_OPEN = 2
+
+# getloc_call values, see skyhookpl/getlocation.h
+CALLS = 12
+HIST_BUCKETS = 320
+CODES = 20
+
+
+class Fix(ctypes.Structure):
+    # mirrors getloc_fix in skyhookpl/getlocation.h, a fixed 64 byte record
+    # the library fills it in place, and the fields are read straight out of its buffer (memoryview(fix) works too)
+    _fields_ = [
+        ("version", ctypes.c_ushort),
+        ("nap", ctypes.c_ushort),
+        ("nsat", ctypes.c_ushort),
+        ("ncell", ctypes.c_ushort),
+        ("latitude", ctypes.c_double),
+        ("longitude", ctypes.c_double),
+        ("altitude", ctypes.c_double),
+        ("hpe", ctypes.c_float),
+        ("speed", ctypes.c_float),
+        ("bearing", ctypes.c_float),
+        ("age", ctypes.c_uint),
+        ("observed", ctypes.c_longlong),
+        ("timestamp", ctypes.c_uint),
+        ("type", ctypes.c_ubyte),
+        ("source", ctypes.c_ubyte),
+        ("reserved", ctypes.c_ubyte * 2),
+    ]
+
+
+assert ctypes.sizeof(Fix) == 64
+
+
+class FenceEvent(ctypes.Structure):
+    # mirrors getloc_fence_event in skyhookpl/getlocation.h
+    _fields_ = [("fence", ctypes.c_int), ("entered", ctypes.c_int), ("fix", Fix)]
+
+
+class AsyncResult(ctypes.Structure):
+    # mirrors getloc_async_result in skyhookpl/getlocation.h
+    _fields_ = [("id", ctypes.c_ulong), ("rc", ctypes.c_int), ("fix", Fix)]
+
+
+class TrackEstimate(ctypes.Structure):
+    # mirrors getloc_track_estimate in skyhookpl/getlocation.h
+    _fields_ = [
+        ("latitude", ctypes.c_double),
+        ("longitude", ctypes.c_double),
+        ("north_velocity", ctypes.c_double),
+        ("east_velocity", ctypes.c_double),
+        ("covariance", ctypes.c_double * 3),
+        ("observed", ctypes.c_longlong),
+        ("accepted", ctypes.c_ulong),
+        ("rejected", ctypes.c_ulong),
+    ]
+
+
+class BreakerInfo(ctypes.Structure):
+    # mirrors getloc_breaker_info in skyhookpl/getlocation.h
+    _fields_ = [
+        ("state", ctypes.c_int),
+        ("failures", ctypes.c_uint),
+        ("opens", ctypes.c_uint),
+        ("retry_in", ctypes.c_ulong),
+        ("rejected", ctypes.c_ulong),
+        ("last", ctypes.c_int),
+    ]
+
+
+class CallStats(ctypes.Structure):
+    # mirrors getloc_call_stats in skyhookpl/getlocation.h
+    _fields_ = [
+        ("count", ctypes.c_ulonglong),
+        ("sum", ctypes.c_ulonglong),
+        ("max", ctypes.c_ulonglong),
+        ("codes", ctypes.c_ulonglong * CODES),
+        ("buckets", ctypes.c_ulonglong * HIST_BUCKETS),
+    ]
+
+
+lib = ctypes.CDLL("skyhookpl/libgetloc.so")
+
+lib.getloc_open.restype = ctypes.c_void_p
+lib.getloc_open.argtypes = [ctypes.c_char_p]
+lib.getloc_locate.restype = ctypes.c_int
+lib.getloc_locate.argtypes = [ctypes.c_void_p, ctypes.POINTER(Fix)]
+lib.getloc_close.argtypes = [ctypes.c_void_p]
+
+lib.getloc_stream_start.restype = ctypes.c_int
+lib.getloc_stream_start.argtypes = [ctypes.c_void_p, ctypes.c_ulong]
+lib.getloc_stream_drain.restype = ctypes.c_uint
+lib.getloc_stream_drain.argtypes = [ctypes.c_void_p, ctypes.POINTER(Fix), ctypes.c_uint]
+lib.getloc_stream_stop.restype = ctypes.c_int
+lib.getloc_stream_stop.argtypes = [ctypes.c_void_p]
+
+lib.getloc_spool_open.restype = ctypes.c_int
+lib.getloc_spool_open.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_uint, ctypes.c_uint]
+lib.getloc_spool_drain.restype = ctypes.c_uint
+lib.getloc_spool_drain.argtypes = [ctypes.c_void_p, ctypes.POINTER(Fix), ctypes.c_uint]
+
+lib.getloc_tiles_open.restype = ctypes.c_int
+lib.getloc_tiles_open.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_uint, ctypes.c_uint, ctypes.c_uint]
+
+lib.getloc_fence_add.restype = ctypes.c_int
+lib.getloc_fence_add.argtypes = [ctypes.c_void_p, ctypes.c_double, ctypes.c_double, ctypes.c_uint, ctypes.c_ulong]
+lib.getloc_fence_fd.restype = ctypes.c_int
+lib.getloc_fence_fd.argtypes = [ctypes.c_void_p]
+lib.getloc_fence_drain.restype = ctypes.c_uint
+lib.getloc_fence_drain.argtypes = [ctypes.c_void_p, ctypes.POINTER(FenceEvent), ctypes.c_uint]
+
+lib.getloc_async_submit.restype = ctypes.c_ulong
+lib.getloc_async_submit.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p]
+lib.getloc_async_fd.restype = ctypes.c_int
+lib.getloc_async_fd.argtypes = [ctypes.c_void_p]
+lib.getloc_async_drain.restype = ctypes.c_uint
+lib.getloc_async_drain.argtypes = [ctypes.c_void_p, ctypes.POINTER(AsyncResult), ctypes.c_uint]
+
+lib.getloc_resolve.restype = ctypes.c_int
+lib.getloc_resolve.argtypes = [ctypes.c_void_p, ctypes.c_ulong, ctypes.POINTER(Fix)]
+
+lib.getloc_track_config.restype = ctypes.c_int
+lib.getloc_track_config.argtypes = [ctypes.c_void_p, ctypes.c_double, ctypes.c_double]
+lib.getloc_track_get.restype = ctypes.c_int
+lib.getloc_track_get.argtypes = [ctypes.c_void_p, ctypes.POINTER(TrackEstimate)]
+
+lib.getloc_remote_locate.restype = ctypes.c_int
+lib.getloc_remote_locate.argtypes = [ctypes.c_char_p, ctypes.POINTER(Fix)]
+
+lib.getloc_publish.restype = ctypes.c_int
+lib.getloc_publish.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+lib.getloc_latest.restype = ctypes.c_int
+lib.getloc_latest.argtypes = [ctypes.c_char_p, ctypes.POINTER(Fix)]
+
+lib.getloc_classify.restype = ctypes.c_int
+lib.getloc_classify.argtypes = [ctypes.c_int]
+lib.getloc_breaker_config.restype = ctypes.c_int
+lib.getloc_breaker_config.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_uint, ctypes.c_ulong, ctypes.c_ulong]
+lib.getloc_breaker_status.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(BreakerInfo)]
+
+lib.getloc_call_name.restype = ctypes.c_char_p
+lib.getloc_call_name.argtypes = [ctypes.c_int]
+lib.getloc_stats_snapshot.argtypes = [ctypes.c_int, ctypes.POINTER(CallStats)]
+lib.getloc_stats_code_index.restype = ctypes.c_uint
+lib.getloc_stats_code_index.argtypes = [ctypes.c_int]
+lib.getloc_stats_quantile.restype = ctypes.c_ulonglong
+lib.getloc_stats_quantile.argtypes = [ctypes.POINTER(CallStats), ctypes.c_double]
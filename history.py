@@ -0,0 +1,36 @@
+# Summarize what the unit recorded locally (see writeToDB.py), without the server, e.g.
+#   python3 history.py usvh 12     the last 12 hours of the Geiger readings
+
+import ctypes
+import datetime
+import os
+import sys
+import time
+import influx
+
+# where writeToDB.py keeps it, opened read-only so a running writeToDB.py can keep appending to it
+HISTORY_PATH = "influxpl/history"
+
+channel = sys.argv[1] if len(sys.argv) > 1 else "usvh"
+hours = float(sys.argv[2]) if len(sys.argv) > 2 else 24
+
+path = f"{HISTORY_PATH}/{channel}.tsdb"
+store = influx.lib.influx_store_open_readonly(path.encode()) if os.path.exists(path) else None
+if not store:
+    sys.exit(f"no local history of {channel}")
+
+to = int(time.time() * 1000)
+summary = influx.StoreSummary()
+influx.lib.influx_store_summarize(store, to - int(hours * 3600 * 1000), to, summary)
+influx.lib.influx_store_close(store)
+
+def at(ms):
+    return datetime.datetime.fromtimestamp(ms / 1000).strftime("%Y-%m-%d %H:%M:%S")
+
+if summary.count == 0:
+    print(f"no {channel} readings in the last {hours:g} hours")
+else:
+    print(f"{channel} over the last {hours:g} hours: {summary.count} readings from {at(summary.first)} to {at(summary.last)}")
+    print(f"  min  {summary.min:g} at {at(summary.min_at)}")
+    print(f"  max  {summary.max:g} at {at(summary.max_at)}")
+    print(f"  mean {summary.sum / summary.count:g}")
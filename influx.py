@@ -0,0 +1,136 @@
+# ctypes bindings for the shared library generated by influxpl/influx_*.c
+
+import ctypes
+
+# influx_status values, see influxpl/influx.h
+OK = 0
+FULL = 1
+INVALID = 2
+NOMEM = 3
+UNREACHABLE = 4
+
+# influx_compression values
+DEADBAND = 0
+SWINGING_DOOR = 1
+
+PREFIX_MAX = 256
+STORE_BLOCK = 4096
+
+
+class Buffer(ctypes.Structure):
+    # mirrors influx_buffer in influxpl/influx.h
+    _fields_ = [
+        ("data", ctypes.POINTER(ctypes.c_char)),
+        ("length", ctypes.c_size_t),
+        ("capacity", ctypes.c_size_t),
+        ("points", ctypes.c_uint),
+    ]
+
+
+class Series(ctypes.Structure):
+    # mirrors influx_series in influxpl/influx.h
+    _fields_ = [("prefix", ctypes.c_char * PREFIX_MAX), ("length", ctypes.c_size_t)]
+
+
+class WriteStats(ctypes.Structure):
+    # mirrors influx_write_stats in influxpl/influx.h
+    _fields_ = [
+        ("points", ctypes.c_ulong),
+        ("sent", ctypes.c_ulong),
+        ("batches", ctypes.c_ulong),
+        ("bytes", ctypes.c_ulong),
+        ("failures", ctypes.c_ulong),
+        ("dropped", ctypes.c_ulong),
+        ("backlog", ctypes.c_ulong),
+        ("status", ctypes.c_long),
+    ]
+
+
+class SpoolInfo(ctypes.Structure):
+    # mirrors influx_spool_info in influxpl/influx.h
+    _fields_ = [
+        ("records", ctypes.c_ulong),
+        ("committed", ctypes.c_ulong),
+        ("evicted", ctypes.c_ulong),
+        ("backlog", ctypes.c_ulong),
+        ("bytes", ctypes.c_ulong),
+        ("segments", ctypes.c_uint),
+        ("damaged", ctypes.c_uint),
+    ]
+
+
+class StoreSummary(ctypes.Structure):
+    # mirrors influx_store_summary in influxpl/influx.h
+    _fields_ = [
+        ("count", ctypes.c_ulong),
+        ("first", ctypes.c_longlong),
+        ("last", ctypes.c_longlong),
+        ("min", ctypes.c_double),
+        ("min_at", ctypes.c_longlong),
+        ("max", ctypes.c_double),
+        ("max_at", ctypes.c_longlong),
+        ("sum", ctypes.c_double),
+    ]
+
+
+class RollupInfo(ctypes.Structure):
+    # mirrors influx_rollup_info in influxpl/influx.h
+    _fields_ = [
+        ("samples", ctypes.c_ulong),
+        ("rollups", ctypes.c_ulong),
+        ("raw", ctypes.c_ulong),
+        ("kept", ctypes.c_ulong),
+        ("late", ctypes.c_ulong),
+    ]
+
+
+lib = ctypes.CDLL("influxpl/libinflux.so")
+
+lib.influx_buffer_init.restype = ctypes.c_int
+lib.influx_buffer_init.argtypes = [ctypes.POINTER(Buffer), ctypes.c_size_t]
+lib.influx_buffer_reset.argtypes = [ctypes.POINTER(Buffer)]
+lib.influx_buffer_free.argtypes = [ctypes.POINTER(Buffer)]
+lib.influx_series_init.restype = ctypes.c_int
+lib.influx_series_init.argtypes = [ctypes.POINTER(Series), ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p)]
+lib.influx_point.restype = ctypes.c_int
+lib.influx_point.argtypes = [ctypes.POINTER(Buffer), ctypes.POINTER(Series), ctypes.POINTER(ctypes.c_char_p), ctypes.POINTER(ctypes.c_double), ctypes.c_uint, ctypes.c_uint, ctypes.c_longlong]
+lib.influx_format_double.restype = ctypes.c_size_t
+lib.influx_format_double.argtypes = [ctypes.c_char_p, ctypes.c_double]
+lib.influx_writer_open.restype = ctypes.c_void_p
+lib.influx_writer_open.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_size_t, ctypes.c_uint]
+lib.influx_writer_point.restype = ctypes.c_int
+lib.influx_writer_point.argtypes = [ctypes.c_void_p, ctypes.POINTER(Series), ctypes.POINTER(ctypes.c_char_p), ctypes.POINTER(ctypes.c_double), ctypes.c_uint, ctypes.c_uint, ctypes.c_longlong]
+lib.influx_writer_flush.restype = ctypes.c_int
+lib.influx_writer_flush.argtypes = [ctypes.c_void_p]
+lib.influx_writer_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(WriteStats)]
+lib.influx_writer_close.argtypes = [ctypes.c_void_p]
+lib.influx_writer_spool.restype = ctypes.c_int
+lib.influx_writer_spool.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_size_t, ctypes.c_size_t]
+lib.influx_spool_open.restype = ctypes.c_void_p
+lib.influx_spool_open.argtypes = [ctypes.c_char_p, ctypes.c_size_t, ctypes.c_size_t]
+lib.influx_spool_status.argtypes = [ctypes.c_void_p, ctypes.POINTER(SpoolInfo)]
+lib.influx_spool_close.argtypes = [ctypes.c_void_p]
+lib.influx_now_ns.restype = ctypes.c_longlong
+lib.influx_now_ns.argtypes = []
+lib.influx_store_open.restype = ctypes.c_void_p
+lib.influx_store_open.argtypes = [ctypes.c_char_p, ctypes.c_uint]
+lib.influx_store_open_readonly.restype = ctypes.c_void_p
+lib.influx_store_open_readonly.argtypes = [ctypes.c_char_p]
+lib.influx_store_append.restype = ctypes.c_int
+lib.influx_store_append.argtypes = [ctypes.c_void_p, ctypes.c_longlong, ctypes.c_double]
+lib.influx_store_scan.restype = ctypes.c_uint
+lib.influx_store_scan.argtypes = [ctypes.c_void_p, ctypes.c_longlong, ctypes.c_longlong, ctypes.POINTER(ctypes.c_longlong), ctypes.POINTER(ctypes.c_double), ctypes.c_uint]
+lib.influx_store_summarize.argtypes = [ctypes.c_void_p, ctypes.c_longlong, ctypes.c_longlong, ctypes.POINTER(StoreSummary)]
+lib.influx_store_sync.argtypes = [ctypes.c_void_p]
+lib.influx_store_close.argtypes = [ctypes.c_void_p]
+lib.influx_rollup_open.restype = ctypes.c_void_p
+lib.influx_rollup_open.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.POINTER(ctypes.c_uint), ctypes.c_uint, ctypes.c_uint]
+lib.influx_rollup_point.restype = ctypes.c_int
+lib.influx_rollup_point.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_char_p), ctypes.POINTER(ctypes.c_double), ctypes.c_uint, ctypes.c_uint, ctypes.c_longlong]
+lib.influx_rollup_compress.restype = ctypes.c_int
+lib.influx_rollup_compress.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_int, ctypes.c_double, ctypes.c_uint]
+lib.influx_rollup_passthrough.restype = ctypes.c_int
+lib.influx_rollup_passthrough.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+lib.influx_rollup_flush.argtypes = [ctypes.c_void_p]
+lib.influx_rollup_status.argtypes = [ctypes.c_void_p, ctypes.POINTER(RollupInfo)]
+lib.influx_rollup_close.argtypes = [ctypes.c_void_p]
@@ -0,0 +1,138 @@
+/*
+   * How many points the compressors keep of synthetic sensor streams, and how far the rebuilt streams are off, e.g.
+   *
+   *     ./compress_bench -d 1
+   *
+   * Runs d days of a DHT11 temperature and humidity (whole units, every 2 s, deadband 0.5), a Geiger reading
+   * (two decimals, every 10 s, deadband 0.05) and a slowly drifting pressure with sensor noise (every 2 s, swinging door
+   * 0.1), all with a 10 minute heartbeat, then rebuilds every sample from the points kept (holding the last one for
+   * the deadband, interpolating for the swinging door) and checks the error stays within tolerance.
+*/
+#include "../influx.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+typedef double (*generator)(unsigned i, unsigned *seed);
+
+static double temperature(unsigned i, unsigned *seed)
+{
+	(void)seed;
+	return (double)(int)(26.5 + 4.5 * sin(i * 2 * 3.141592653589793 / 43200));
+}
+
+static double humidity(unsigned i, unsigned *seed)
+{
+	// mostly the daily swing, with the odd reading a percent off as a DHT11 gives
+	return (double)(int)(60.5 - 15 * sin(i * 2 * 3.141592653589793 / 43200)) + (rand_r(seed) % 50 == 0 ? 1 : 0);
+}
+
+static double usvh(unsigned i, unsigned *seed)
+{
+	(void)i;
+	unsigned counts = 10 + rand_r(seed) % 15;
+	return (double)(long)(counts * 0.00812037037037 * 100 + 0.5) / 100;
+}
+
+static double pressure(unsigned i, unsigned *seed)
+{
+	return 1010 + 4 * sin(i * 2 * 3.141592653589793 / 21600) + (rand_r(seed) % 1000) / 1000.0 * 0.1 - 0.05;
+}
+
+static void bench(const char *name, influx_compression mode, double tolerance, unsigned period_ms, unsigned days, generator value)
+{
+	unsigned n = days * 86400u / (period_ms / 1000);
+	long long *timestamps = malloc(n * sizeof(long long));
+	double *values = malloc(n * sizeof(double));
+	long long *kept_at = malloc((n + 1) * sizeof(long long));
+	double *kept = malloc((n + 1) * sizeof(double));
+	influx_compressor *compressor = influx_compressor_open(mode, tolerance, 10 * 60 * 1000);
+	if (timestamps == NULL || values == NULL || kept_at == NULL || kept == NULL || compressor == NULL || n == 0)
+	{
+		return;
+	}
+
+	unsigned seed = 1;
+	long long t = 1700000000000000000LL;
+	for (unsigned i = 0; i < n; i++)
+	{
+		t += (period_ms + (long long)(rand_r(&seed) % 11) - 5) * 1000000LL;
+		timestamps[i] = t;
+		values[i] = value(i, &seed);
+	}
+
+	unsigned m = 0;
+	double begin = now_ns();
+	for (unsigned i = 0; i < n; i++)
+	{
+		m += influx_compressor_sample(compressor, timestamps[i], values[i], &kept_at[m], &kept[m]);
+	}
+	m += influx_compressor_flush(compressor, &kept_at[m], &kept[m]);
+	double compressed = now_ns();
+	influx_compressor_close(compressor);
+
+	// rebuild every sample from the points around it
+	double error = 0;
+	long long gap = 0;
+	unsigned k = 0;
+	for (unsigned i = 0; i < n; i++)
+	{
+		while (k + 1 < m && kept_at[k + 1] <= timestamps[i])
+		{
+			k++;
+		}
+		double rebuilt = kept[k];
+		if (mode == INFLUX_SWINGING_DOOR && k + 1 < m && kept_at[k] < timestamps[i])
+		{
+			rebuilt += (kept[k + 1] - kept[k]) * (double)(timestamps[i] - kept_at[k]) / (double)(kept_at[k + 1] - kept_at[k]);
+		}
+		error = fabs(rebuilt - values[i]) > error ? fabs(rebuilt - values[i]) : error;
+	}
+	for (unsigned j = 1; j < m; j++)
+	{
+		gap = kept_at[j] - kept_at[j - 1] > gap ? kept_at[j] - kept_at[j - 1] : gap;
+	}
+
+	printf("%-12s %-14s %4.2f  %8u samples  %7u kept (%5.2f%%)  longest gap %5.1f min  max error %6.4f  %5.1f ns/sample  %s\n", name, mode == INFLUX_DEADBAND ? "deadband" : "swinging door",
+	       tolerance, n, m, 100.0 * m / n, gap / 6e10, error, (compressed - begin) / n, error <= tolerance + 1e-9 ? "within tolerance" : "OUT OF TOLERANCE");
+
+	free(timestamps);
+	free(values);
+	free(kept_at);
+	free(kept);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned days = 1;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "d:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'd':
+			days = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-d days]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	bench("temperature", INFLUX_DEADBAND, 0.5, 2000, days, temperature);
+	bench("humidity", INFLUX_DEADBAND, 0.5, 2000, days, humidity);
+	bench("usvh", INFLUX_DEADBAND, 0.05, 10000, days, usvh);
+	bench("pressure", INFLUX_SWINGING_DOOR, 0.1, 2000, days, pressure);
+	bench("usvh", INFLUX_SWINGING_DOOR, 0.05, 10000, days, usvh);
+	return 0;
+}
@@ -0,0 +1,149 @@
+/*
+   * Throughput of the line protocol encoder, against the snprintf() it replaces, e.g.
+   *
+   *     ./influx_bench -n 1000000
+   *
+   * Every benchmark encodes n points into a 64 KB payload (reset whenever it fills up, as a writer would
+   * after sending it) and reports points per second, nanoseconds per point and the payload bytes produced.
+*/
+#include "../influx.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PAYLOAD (64 * 1024)
+
+static double now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void report(const char *name, unsigned n, double elapsed_ns, unsigned long long bytes)
+{
+	printf("%-20s n=%-9u %12.0f points/s %8.1f ns/point %8.1f MB/s\n", name, n, n / (elapsed_ns / 1e9), elapsed_ns / n, bytes / (elapsed_ns / 1e3));
+}
+
+// a DHT reading and a Geiger reading, as dht.py and geiger.py take them
+static double temperature(unsigned i)
+{
+	return 20 + (i % 150) / 10.0;
+}
+
+static double humidity(unsigned i)
+{
+	return 40 + (i % 7);
+}
+
+static double usvh(unsigned i)
+{
+	return 0.00812037037037 * (10 + i % 40);
+}
+
+static void bench_native(unsigned n)
+{
+	influx_buffer buffer;
+	influx_series dht, geiger;
+	const char *tags[] = { "location", "Hyderabad", "unit", "pi-01", NULL };
+	const char *dht_keys[] = { "temp", "humid" };
+	const char *geiger_keys[] = { "usvh" };
+	unsigned long long bytes = 0;
+
+	if (influx_buffer_init(&buffer, PAYLOAD) != INFLUX_OK || influx_series_init(&dht, "dht", tags) != INFLUX_OK || influx_series_init(&geiger, "geiger", tags) != INFLUX_OK)
+	{
+		return;
+	}
+
+	long long timestamp = 1700000000000000000LL;
+	double start = now_ns();
+	for (unsigned i = 0; i < n; i++)
+	{
+		double values[2] = { temperature(i), humidity(i) };
+		const influx_series *series = i % 4 == 3 ? &geiger : &dht;
+		const char *const *keys = i % 4 == 3 ? geiger_keys : dht_keys;
+		unsigned fields = i % 4 == 3 ? 1 : 2;
+		if (i % 4 == 3)
+		{
+			values[0] = usvh(i);
+		}
+
+		if (influx_point(&buffer, series, keys, values, 0, fields, timestamp + i * 2000000000LL) == INFLUX_FULL)
+		{
+			bytes += buffer.length;
+			influx_buffer_reset(&buffer);
+			influx_point(&buffer, series, keys, values, 0, fields, timestamp + i * 2000000000LL);
+		}
+	}
+	bytes += buffer.length;
+	report("influx_point", n, now_ns() - start, bytes);
+
+	influx_buffer_free(&buffer);
+}
+
+static void bench_snprintf(unsigned n)
+{
+	char *payload = malloc(PAYLOAD);
+	size_t length = 0;
+	unsigned long long bytes = 0;
+	if (payload == NULL)
+	{
+		return;
+	}
+
+	long long timestamp = 1700000000000000000LL;
+	double start = now_ns();
+	for (unsigned i = 0; i < n; i++)
+	{
+		char line[256];
+		int written;
+		if (i % 4 == 3)
+		{
+			written = snprintf(line, sizeof(line), "geiger,location=Hyderabad,unit=pi-01 usvh=%.17g %lld\n", usvh(i), timestamp + i * 2000000000LL);
+		}
+		else
+		{
+			written = snprintf(line, sizeof(line), "dht,location=Hyderabad,unit=pi-01 temp=%.17g,humid=%.17g %lld\n", temperature(i), humidity(i), timestamp + i * 2000000000LL);
+		}
+		if (length + (size_t)written > PAYLOAD)
+		{
+			bytes += length;
+			length = 0;
+		}
+		memcpy(payload + length, line, (size_t)written);
+		length += (size_t)written;
+	}
+	bytes += length;
+	report("snprintf %.17g", n, now_ns() - start, bytes);
+
+	free(payload);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned n = 1000000;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "n:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n':
+			n = (unsigned)atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n points]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (n == 0)
+	{
+		return 1;
+	}
+
+	bench_native(n);
+	bench_snprintf(n);
+	return 0;
+}
@@ -0,0 +1,20 @@
+# build influx_bench, along with its own libinflux.so
+#
+# run it with e.g.
+#   ./influx_bench -n 1000000
+
+cd "$(dirname "$0")"
+
+gcc -O2 -fPIC -shared -o libinflux.so ../influx_*.c -lm -lpthread -lcurl
+gcc -O2 -o influx_bench influx_bench.c -L. -linflux -lm -Wl,-rpath,'$ORIGIN'
+
+# writer_bench measures influx_writer against a server, e.g. the stand-in from ../stub/setup.sh:
+#   ../stub/influx_stub -p 8086 &
+#   ./writer_bench -u http://127.0.0.1:8086 -n 100000 -r 1000
+gcc -O2 -o writer_bench writer_bench.c -L. -linflux -Wl,-rpath,'$ORIGIN'
+
+# store_bench reports how compactly the on-device store keeps sensor streams, e.g. ./store_bench -d 21
+gcc -O2 -o store_bench store_bench.c -L. -linflux -lm -Wl,-rpath,'$ORIGIN'
+
+# compress_bench reports how many points the compressors keep and how far the rebuilt streams are off, e.g. ./compress_bench -d 1
+gcc -O2 -o compress_bench compress_bench.c -L. -linflux -lm -Wl,-rpath,'$ORIGIN'
@@ -0,0 +1,135 @@
+/*
+   * Compression and speed of the on-device store, on synthetic sensor streams, e.g.
+   *
+   *     ./store_bench -d 21
+   *
+   * Writes d days of a DHT11 temperature (whole degrees, every 2 s) and a Geiger reading (two decimals, every 10 s),
+   * both with a few ms of timing jitter as the Python loops have, into stores in /tmp, then reports the bytes
+   * per point, the append and scan rates and checks that every point reads back exactly.
+*/
+#include "../influx.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+typedef double (*generator)(unsigned i, unsigned *seed);
+
+static double temperature(unsigned i, unsigned *seed)
+{
+	(void)seed;
+	// a daily swing between 22 and 31 degrees, quantized as a DHT11 does
+	return (double)(int)(26.5 + 4.5 * sin(i * 2 * 3.141592653589793 / 43200));
+}
+
+static double usvh(unsigned i, unsigned *seed)
+{
+	(void)i;
+	// counts over a minute times the J305 factor, rounded to two decimals as geiger.py does
+	unsigned counts = 10 + rand_r(seed) % 15;
+	return (double)(long)(counts * 0.00812037037037 * 100 + 0.5) / 100;
+}
+
+static void bench(const char *name, const char *path, unsigned period_ms, unsigned days, generator value)
+{
+	unsigned n = days * 86400u / (period_ms / 1000);
+	unsigned blocks = 4096;
+	unlink(path);
+	influx_store *store = influx_store_open(path, blocks);
+	long long *timestamps = malloc(n * sizeof(long long));
+	double *values = malloc(n * sizeof(double));
+	if (store == NULL || timestamps == NULL || values == NULL)
+	{
+		return;
+	}
+
+	unsigned seed = 1;
+	long long t = 1700000000000LL;
+	for (unsigned i = 0; i < n; i++)
+	{
+		t += period_ms + (long long)(rand_r(&seed) % 11) - 5;
+		timestamps[i] = t;
+		values[i] = value(i, &seed);
+	}
+
+	double begin = now_ns();
+	for (unsigned i = 0; i < n; i++)
+	{
+		influx_store_append(store, timestamps[i], values[i]);
+	}
+	double appended = now_ns();
+
+	long long *read_timestamps = malloc(n * sizeof(long long));
+	double *read_values = malloc(n * sizeof(double));
+	unsigned m = influx_store_scan(store, timestamps[0], timestamps[n - 1], read_timestamps, read_values, n);
+	double scanned = now_ns();
+
+	influx_store_summary summary;
+	influx_store_summarize(store, timestamps[n / 3], timestamps[2 * n / 3], &summary);
+	double summarized = now_ns();
+
+	unsigned mismatches = m == n ? 0 : 1;
+	for (unsigned i = 0; i < m && i < n; i++)
+	{
+		mismatches += read_timestamps[i] != timestamps[i] || read_values[i] != values[i];
+	}
+
+	influx_store_close(store);
+	store = influx_store_open(path, blocks);
+	unsigned reopened = influx_store_scan(store, timestamps[0], timestamps[n - 1], read_timestamps, read_values, n);
+	influx_store_close(store);
+
+	// blocks in use, from the points' share of the ring
+	double bytes = 0;
+	FILE *file = fopen(path, "rb");
+	unsigned char block[INFLUX_STORE_BLOCK];
+	while (file != NULL && fread(block, sizeof(block), 1, file) == 1)
+	{
+		bytes += block[0] != 0 ? INFLUX_STORE_BLOCK : 0;
+	}
+	if (file != NULL)
+	{
+		fclose(file);
+	}
+
+	printf("%-12s %u days, %9u points  %6.2f bytes/point  %7.1f KB  append %5.1f ns/point  scan %5.1f ns/point  summary %6.1f us  %s%s\n", name, days, n, bytes / n, bytes / 1024,
+	       (appended - begin) / n, (scanned - appended) / n, (summarized - scanned) / 1e3, mismatches == 0 ? "exact" : "MISMATCH", reopened == n ? "" : " (LOST ON REOPEN)");
+
+	unlink(path);
+	free(timestamps);
+	free(values);
+	free(read_timestamps);
+	free(read_values);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned days = 21;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "d:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'd':
+			days = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-d days]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	bench("temperature", "/tmp/store_bench_temp.tsdb", 2000, days, temperature);
+	bench("usvh", "/tmp/store_bench_usvh.tsdb", 10000, days, usvh);
+	return 0;
+}
@@ -0,0 +1,142 @@
+/*
+   * Latency of influx_writer_point() while the flush thread sends batches, and what reached the server, e.g.
+   *
+   *     ../stub/influx_stub -p 8086 &
+   *     ./writer_bench -u http://127.0.0.1:8086 -n 100000 -r 1000
+   *
+   * Points are written at r per second (0 for as fast as possible) from one thread, as the sensor scripts do,
+   * and the enqueue latency percentiles are reported next to the writer's counters after the final flush.
+   * With -s, points go through a write-ahead spool in that directory (see influx_writer_spool()), and whatever
+   * a previous run left there is replayed first. With -w, points go through 1m/15m/1h rollups instead (see
+   * influx_rollup_open()), with the raw points passed on once every that many ms of point time (0 for none).
+*/
+#include "../influx.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compare(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+	const char *url = "http://127.0.0.1:8086";
+	unsigned n = 100000;
+	unsigned rate = 0;
+	size_t batch = 64 * 1024;
+	unsigned flush_ms = 1000;
+	const char *spool = NULL;
+	long raw_ms = -1;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "u:n:r:b:f:s:w:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'u':
+			url = optarg;
+			break;
+		case 'n':
+			n = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			rate = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			batch = strtoul(optarg, NULL, 10);
+			break;
+		case 'f':
+			flush_ms = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		case 's':
+			spool = optarg;
+			break;
+		case 'w':
+			raw_ms = strtol(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-u url] [-n points] [-r points/s] [-b batch bytes] [-f flush ms] [-s spool directory] [-w raw ms]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	influx_writer *writer = influx_writer_open(url, "org", "bucket", "token", batch, flush_ms);
+	influx_series geiger;
+	const char *tags[] = { "location", "Hyderabad", "unit", "pi-01", NULL };
+	const char *keys[] = { "usvh" };
+	double *latencies = malloc(n * sizeof(double));
+	if (writer == NULL || latencies == NULL || n == 0 || influx_series_init(&geiger, "geiger", tags) != INFLUX_OK)
+	{
+		return 1;
+	}
+	if (spool != NULL && influx_writer_spool(writer, spool, 1024 * 1024, 64 * 1024 * 1024) != INFLUX_OK)
+	{
+		fprintf(stderr, "*** could not open the spool in %s!\n", spool);
+		return 1;
+	}
+	influx_rollup *rollup = NULL;
+	if (raw_ms >= 0)
+	{
+		static const unsigned windows[] = { 60, 15 * 60, 60 * 60 };
+		rollup = influx_rollup_open(writer, "geiger", tags, windows, 3, (unsigned)raw_ms);
+		if (rollup == NULL)
+		{
+			return 1;
+		}
+	}
+
+	double started = now_ns();
+	long long timestamp = 1700000000000000000LL;
+	for (unsigned i = 0; i < n; i++)
+	{
+		if (rate > 0)
+		{
+			double due = started + i * (1e9 / rate);
+			double wait = due - now_ns();
+			if (wait > 0)
+			{
+				usleep((useconds_t)(wait / 1e3));
+			}
+		}
+
+		double value = 0.00812037037037 * (10 + i % 40);
+		double begin = now_ns();
+		if (rollup != NULL)
+		{
+			influx_rollup_point(rollup, keys, &value, 0, 1, timestamp + i * 1000000LL);
+		}
+		else
+		{
+			influx_writer_point(writer, &geiger, keys, &value, 0, 1, timestamp + i * 1000000LL);
+		}
+		latencies[i] = now_ns() - begin;
+	}
+	influx_rollup_close(rollup);
+	double written = now_ns();
+	influx_status rc = influx_writer_flush(writer);
+	double flushed = now_ns();
+
+	qsort(latencies, n, sizeof(double), compare);
+	printf("enqueue    p50 %8.0f ns  p99 %8.0f ns  p99.9 %8.0f ns  max %8.0f ns\n", latencies[n / 2], latencies[(size_t)(n * 0.99)], latencies[(size_t)(n * 0.999)], latencies[n - 1]);
+	printf("written    %u points in %.1f ms, final flush %.1f ms (%s)\n", n, (written - started) / 1e6, (flushed - written) / 1e6, rc == INFLUX_OK ? "ok" : "unreachable");
+
+	influx_write_stats stats;
+	influx_writer_stats(writer, &stats);
+	printf("writer     points %lu  sent %lu  batches %lu  bytes %lu  failures %lu  dropped %lu  backlog %lu  last status %ld\n", stats.points, stats.sent, stats.batches, stats.bytes, stats.failures, stats.dropped, stats.backlog, stats.status);
+
+	influx_writer_close(writer);
+	free(latencies);
+	return 0;
+}
@@ -0,0 +1,259 @@
+#ifndef _INFLUX_H_
+#define _INFLUX_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+	INFLUX_OK = 0,
+	INFLUX_FULL = 1,    // the buffer has no room for the point, send it and reset
+	INFLUX_INVALID = 2, // bad argument, e.g. an empty name or a NaN value
+	INFLUX_NOMEM = 3,
+	INFLUX_UNREACHABLE = 4 // the server couldn't be reached or didn't accept the batch
+} influx_status;
+
+/*
+   * Line protocol encoding.
+   * Points are appended to a buffer allocated once with influx_buffer_init() and reused after every
+   * influx_buffer_reset(), so encoding never allocates; many points from many sensors go into one payload.
+   *
+   * A series is a measurement and its tag set, escaped once by influx_series_init() and copied in verbatim
+   * for every point. Field keys are escaped as they are written (they are short and usually need nothing).
+   * Values are formatted without printf, so neither the locale nor an allocation can get in the way:
+   * integral values up to 2^53 are written as such, others with INFLUX_DIGITS significant digits (trailing zeros
+   * dropped), in exponent notation if they are very large or small.
+   * Fields set in integers (bit i for field i) are written as integers instead, with the 'i' suffix,
+   * so values that used to be written as Python ints keep their field type on the server.
+*/
+#define INFLUX_PREFIX_MAX 256
+#define INFLUX_DIGITS 15
+
+typedef struct
+{
+	char *data;
+	size_t length;
+	size_t capacity;
+	unsigned points;
+} influx_buffer;
+
+typedef struct
+{
+	char prefix[INFLUX_PREFIX_MAX]; // "measurement,tag=value,..."
+	size_t length;
+} influx_series;
+
+influx_status influx_buffer_init(influx_buffer *buffer, size_t capacity);
+void influx_buffer_reset(influx_buffer *buffer);
+void influx_buffer_free(influx_buffer *buffer);
+
+// tags is a NULL terminated list of key, value pairs, sorted by key as the server prefers
+influx_status influx_series_init(influx_series *series, const char *measurement, const char *const *tags);
+
+// append one point of n (at most 32) fields, with a timestamp in nanoseconds since the unix epoch (0 to let the server stamp it)
+influx_status influx_point(influx_buffer *buffer, const influx_series *series, const char *const *keys, const double *values, unsigned integers, unsigned n, long long timestamp);
+
+/*
+   * Sample time.
+   * influx_now_ns() is CLOCK_MONOTONIC mapped to wall time (nanoseconds since the unix epoch), for stamping a
+   * reading when the sensor is sampled rather than when it reaches the server. Readings taken close together
+   * are spaced by the monotonic clock, and the mapping is re-measured every second, so a step of the wall clock
+   * (a Pi has no RTC, NTP sets it some time after boot) is picked up within a second.
+*/
+long long influx_now_ns();
+
+// format a value the way influx_point() does, returns its length (at most 32 characters, not terminated)
+size_t influx_format_double(char *out, double value);
+
+/*
+   * Batched writer.
+   * influx_writer_open() starts a flush thread that owns one libcurl handle, so every batch is POSTed to
+   * url/api/v2/write over the same keep-alive connection instead of a new one per value.
+   * influx_writer_point() only encodes the point into the current batch, it never waits for the network.
+   * The flush thread sends the batch once it holds batch_bytes, or its oldest point is flush_ms old,
+   * while new points go into a second buffer of the same size; points that find both full are dropped and counted.
+   * A batch the server didn't take is retried after flush_ms, backing off twice as long after every failure in a
+   * row up to 5 minutes, except for one rejected as malformed or too large (400, 413, 422), which would only fail
+   * again and is dropped. Auth and not found errors (401, 403, 404) are retried like an unreachable server,
+   * so the points go through once the token or bucket is fixed.
+   * influx_writer_flush() waits for everything written so far to be sent, or for the next attempt to fail.
+   * influx_writer_close() flushes and stops the thread.
+*/
+typedef struct influx_writer influx_writer;
+
+typedef struct
+{
+	unsigned long points;   // accepted by influx_writer_point()
+	unsigned long sent;     // points the server took
+	unsigned long batches;
+	unsigned long bytes;
+	unsigned long failures; // attempts that didn't go through
+	unsigned long dropped;  // points lost to full buffers, rejected batches or the spool's cap
+	unsigned long backlog;  // points waiting to be sent
+	long status;            // HTTP status of the latest attempt, 0 if it never got an answer
+} influx_write_stats;
+
+influx_writer *influx_writer_open(const char *url, const char *org, const char *bucket, const char *token, size_t batch_bytes, unsigned flush_ms);
+influx_status influx_writer_point(influx_writer *writer, const influx_series *series, const char *const *keys, const double *values, unsigned integers, unsigned n, long long timestamp);
+influx_status influx_writer_flush(influx_writer *writer);
+void influx_writer_stats(influx_writer *writer, influx_write_stats *stats);
+void influx_writer_close(influx_writer *writer);
+
+/*
+   * On-device store.
+   * One file per channel, a ring of INFLUX_STORE_BLOCK byte blocks mapped into memory, each compressed the
+   * way Gorilla does it: timestamps (ms since the unix epoch) as deltas of deltas, values xor'ed with the previous
+   * one, so a reading every few seconds costs a byte or two and a value that doesn't change a couple of bits.
+   * A full ring overwrites its oldest block. Every block also keeps the count, min, max and sum of its points,
+   * so influx_store_summarize() only decodes the blocks at the edges of the range.
+   *
+   * influx_store_open() creates the file with blocks blocks (an existing file keeps its size).
+   * influx_store_open_readonly() opens an existing one for scans and summaries only, never writing to the file,
+   * e.g. while another process appends to it.
+   * influx_store_append() takes points in time order, an older one is INFLUX_INVALID.
+   * influx_store_scan() copies up to max points in [from, to] out, oldest first; call it again from the
+   * timestamp after the last one to page through a range.
+*/
+#define INFLUX_STORE_BLOCK 4096
+
+typedef struct influx_store influx_store;
+
+typedef struct
+{
+	unsigned long count;
+	long long first;
+	long long last;
+	double min;
+	long long min_at;
+	double max;
+	long long max_at;
+	double sum;
+} influx_store_summary;
+
+influx_store *influx_store_open(const char *path, unsigned blocks);
+influx_store *influx_store_open_readonly(const char *path);
+influx_status influx_store_append(influx_store *store, long long timestamp, double value);
+unsigned influx_store_scan(influx_store *store, long long from, long long to, long long *timestamps, double *values, unsigned max);
+void influx_store_summarize(influx_store *store, long long from, long long to, influx_store_summary *summary);
+void influx_store_sync(influx_store *store);
+void influx_store_close(influx_store *store);
+
+/*
+   * Compression.
+   * A compressor decides which samples of one channel (timestamps in ns) need to be kept, so that the dropped
+   * ones can be rebuilt from the kept ones to within tolerance:
+   *   INFLUX_DEADBAND       keeps a sample once it is more than tolerance from the last one kept, and the last kept
+   *                         value holds until the next (suits quantized readings, e.g. a DHT11's whole degrees with 0.5)
+   *   INFLUX_SWINGING_DOOR  keeps the points of a piecewise linear trend, interpolating between them passes every
+   *                         dropped sample within tolerance (suits drifting readings)
+   * Once heartbeat_ms have passed since the last point kept, the next sample is kept regardless (0 for never), so a
+   * flat channel still shows it is alive.
+   *
+   * influx_compressor_sample() returns 1 with the point to keep in archived_at, archived, which may be an earlier
+   * sample the swinging door held back; influx_compressor_flush() does the same for the sample still held, if any.
+*/
+typedef enum
+{
+	INFLUX_DEADBAND,
+	INFLUX_SWINGING_DOOR
+} influx_compression;
+
+typedef struct influx_compressor influx_compressor;
+
+influx_compressor *influx_compressor_open(influx_compression mode, double tolerance, unsigned heartbeat_ms);
+unsigned influx_compressor_sample(influx_compressor *compressor, long long timestamp, double value, long long *archived_at, double *archived);
+unsigned influx_compressor_flush(influx_compressor *compressor, long long *archived_at, double *archived);
+void influx_compressor_close(influx_compressor *compressor);
+
+/*
+   * Rollups.
+   * A rollup sits in front of a writer and aggregates the samples of a measurement over tumbling windows of the
+   * given lengths in seconds (ascending, aligned to the unix epoch, so e.g. 60, 900 and 3600 close on the minute,
+   * quarter and hour). Every sample costs O(1) per window: min, max, sum, count and last per channel (field key).
+   * When a sample lands in a later window, the closed one is written as one point of <measurement>_1m (or _15m,
+   * _1h, ...) stamped with its start, with <channel>_min, _max, _mean, _count and _last fields.
+   *
+   * Raw samples are passed on as they came at most once every raw_ms (0 for rollups only).
+   * A sample older than a window already written only counts towards the raw rate.
+   * influx_rollup_compress() sends a channel's raw samples through a compressor instead, as points of their own
+   * with just that field, whenever the compressor keeps one (the other channels keep to raw_ms).
+   * influx_rollup_passthrough() marks a key as describing the sample rather than measuring something (e.g. the
+   * coordinates it was taken at): it is never aggregated and takes no channel, it only rides along on the raw and
+   * kept points of the sample it came with. A raw point with nothing but passthrough fields left is not written.
+   * influx_rollup_flush() writes the windows still open as they are and the samples compressors hold, e.g. before
+   * exiting; close does it too. A flushed window is closed, later samples that fall into it count as late.
+*/
+#define INFLUX_ROLLUP_WINDOWS 4
+#define INFLUX_ROLLUP_CHANNELS 6    // five fields each, within influx_point()'s 32
+#define INFLUX_ROLLUP_PASSTHROUGH 4
+
+typedef struct influx_rollup influx_rollup;
+
+typedef struct
+{
+	unsigned long samples;
+	unsigned long rollups; // points written for closed windows
+	unsigned long raw;     // samples passed on
+	unsigned long kept;    // compressed samples passed on
+	unsigned long late;
+} influx_rollup_info;
+
+influx_rollup *influx_rollup_open(influx_writer *writer, const char *measurement, const char *const *tags, const unsigned *windows, unsigned nwindows, unsigned raw_ms);
+influx_status influx_rollup_point(influx_rollup *rollup, const char *const *keys, const double *values, unsigned integers, unsigned n, long long timestamp);
+influx_status influx_rollup_compress(influx_rollup *rollup, const char *key, influx_compression mode, double tolerance, unsigned heartbeat_ms);
+influx_status influx_rollup_passthrough(influx_rollup *rollup, const char *key);
+void influx_rollup_flush(influx_rollup *rollup);
+void influx_rollup_status(influx_rollup *rollup, influx_rollup_info *info);
+void influx_rollup_close(influx_rollup *rollup);
+
+/*
+   * Write-ahead spool.
+   * An append-only log of points on disk, in segment files of segment_bytes mapped into memory, so a point
+   * survives the server being unreachable, the process dying and (but for the last sync interval) a power loss.
+   * Every record carries a crc32; reopening the spool replays it up to the first record that doesn't check out.
+   * Once it holds max_bytes, the oldest segment is dropped, unsent points and all.
+   * A spool belongs to one process at a time: open takes an exclusive lock on the directory, and fails while
+   * another process holds it, so every process writing points needs a directory of its own.
+   *
+   * influx_spool_peek() copies the points from the read position on into buffer, as many as fit;
+   * influx_spool_commit() moves the read position past them once they are sent, deleting segments as they empty.
+   * influx_spool_sync() makes everything appended so far durable.
+   *
+   * With influx_writer_spool(), every point a writer takes goes through the spool before it is sent,
+   * the flush thread syncs it before each batch and replays a backlog (e.g. from a previous run) in batches as
+   * large as its buffers allow. The writer no longer drops anything when the server is unreachable,
+   * and influx_writer_close() leaves what wasn't sent in the spool for the next run.
+*/
+typedef struct influx_spool influx_spool;
+
+typedef struct
+{
+	unsigned long records;   // appended, including the backlog found on open
+	unsigned long committed; // sent
+	unsigned long evicted;   // dropped with the oldest segment
+	unsigned long backlog;   // waiting
+	unsigned long bytes;     // line protocol waiting
+	unsigned segments;
+	unsigned damaged;        // segments found to end in a record that didn't check out
+} influx_spool_info;
+
+influx_spool *influx_spool_open(const char *directory, size_t segment_bytes, size_t max_bytes);
+influx_status influx_spool_append(influx_spool *spool, const char *line, size_t length);
+unsigned influx_spool_peek(influx_spool *spool, influx_buffer *buffer);
+void influx_spool_commit(influx_spool *spool);
+void influx_spool_sync(influx_spool *spool);
+size_t influx_spool_backlog(influx_spool *spool);
+void influx_spool_status(influx_spool *spool, influx_spool_info *info);
+void influx_spool_close(influx_spool *spool);
+
+// route a writer's points through a spool in directory, before any are written; the writer owns it from then on
+influx_status influx_writer_spool(influx_writer *writer, const char *directory, size_t segment_bytes, size_t max_bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _INFLUX_H_
@@ -0,0 +1,47 @@
+#include "./influx.h"
+#include <limits.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#define RESYNC_NS 1000000000LL
+
+static long long clock_ns(clockid_t clock)
+{
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// CLOCK_REALTIME - CLOCK_MONOTONIC, from the tightest of a few monotonic reads around a realtime one
+static long long measure_offset()
+{
+	long long width = LLONG_MAX;
+	long long offset = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		long long before = clock_ns(CLOCK_MONOTONIC);
+		long long wall = clock_ns(CLOCK_REALTIME);
+		long long after = clock_ns(CLOCK_MONOTONIC);
+		if (after - before < width)
+		{
+			width = after - before;
+			offset = wall - (before + width / 2);
+		}
+	}
+	return offset;
+}
+
+long long influx_now_ns()
+{
+	static atomic_llong offset;
+	static atomic_llong next_sync; // CLOCK_MONOTONIC ns
+
+	// racing threads may both measure, either answer will do
+	long long now = clock_ns(CLOCK_MONOTONIC);
+	if (now >= atomic_load_explicit(&next_sync, memory_order_acquire))
+	{
+		atomic_store_explicit(&offset, measure_offset(), memory_order_relaxed);
+		atomic_store_explicit(&next_sync, now + RESYNC_NS, memory_order_release);
+	}
+	return now + atomic_load_explicit(&offset, memory_order_relaxed);
+}
@@ -0,0 +1,128 @@
+#include "./influx.h"
+#include <stdlib.h>
+
+struct influx_compressor
+{
+	influx_compression mode;
+	double tolerance;
+	long long heartbeat; // ns, 0 for none
+	int started;         // whether a point has been archived yet
+	long long at;        // the archived point
+	double value;
+	int held;            // whether there is a sample after it that isn't archived
+	long long held_at;
+	double held_value;
+	double lower;        // slopes from the archived point that keep every sample since within tolerance
+	double upper;
+};
+
+influx_compressor *influx_compressor_open(influx_compression mode, double tolerance, unsigned heartbeat_ms)
+{
+	if ((mode != INFLUX_DEADBAND && mode != INFLUX_SWINGING_DOOR) || !(tolerance >= 0))
+	{
+		return NULL;
+	}
+
+	influx_compressor *compressor = calloc(1, sizeof(*compressor));
+	if (compressor == NULL)
+	{
+		return NULL;
+	}
+	compressor->mode = mode;
+	compressor->tolerance = tolerance;
+	compressor->heartbeat = heartbeat_ms * 1000000LL;
+	return compressor;
+}
+
+// the held sample becomes the archived point, and the sample at, value the first one after it
+static unsigned archive_held(influx_compressor *compressor, long long at, double value, long long *archived_at, double *archived)
+{
+	compressor->at = compressor->held_at;
+	compressor->value = compressor->held_value;
+	*archived_at = compressor->at;
+	*archived = compressor->value;
+
+	double span = (double)(at - compressor->at);
+	compressor->lower = (value - compressor->tolerance - compressor->value) / span;
+	compressor->upper = (value + compressor->tolerance - compressor->value) / span;
+	compressor->held_at = at;
+	compressor->held_value = value;
+	return 1;
+}
+
+unsigned influx_compressor_sample(influx_compressor *compressor, long long timestamp, double value, long long *archived_at, double *archived)
+{
+	if (compressor == NULL || value != value || (compressor->started && timestamp <= compressor->at) || (compressor->held && timestamp <= compressor->held_at))
+	{
+		return 0;
+	}
+
+	int expired = compressor->heartbeat > 0 && compressor->started && timestamp - compressor->at >= compressor->heartbeat;
+	int outside = value > compressor->value + compressor->tolerance || value < compressor->value - compressor->tolerance;
+	if (!compressor->started || (compressor->mode == INFLUX_DEADBAND && (outside || expired)) || (expired && !compressor->held))
+	{
+		compressor->started = 1;
+		compressor->held = 0;
+		compressor->at = timestamp;
+		compressor->value = value;
+		*archived_at = timestamp;
+		*archived = value;
+		return 1;
+	}
+
+	if (compressor->mode == INFLUX_DEADBAND)
+	{
+		// held only for influx_compressor_flush(), holding the archived value reconstructs it
+		compressor->held = 1;
+		compressor->held_at = timestamp;
+		compressor->held_value = value;
+		return 0;
+	}
+
+	double span = (double)(timestamp - compressor->at);
+	if (!compressor->held)
+	{
+		compressor->held = 1;
+		compressor->held_at = timestamp;
+		compressor->held_value = value;
+		compressor->lower = (value - compressor->tolerance - compressor->value) / span;
+		compressor->upper = (value + compressor->tolerance - compressor->value) / span;
+		return 0;
+	}
+
+	// a line from the archived point straight to this sample has to pass every sample since within tolerance,
+	// otherwise the door is shut and the sample held before it is archived; the heartbeat does the same
+	double slope = (value - compressor->value) / span;
+	if (slope < compressor->lower || slope > compressor->upper || expired)
+	{
+		return archive_held(compressor, timestamp, value, archived_at, archived);
+	}
+
+	double lower = (value - compressor->tolerance - compressor->value) / span;
+	double upper = (value + compressor->tolerance - compressor->value) / span;
+	compressor->lower = lower > compressor->lower ? lower : compressor->lower;
+	compressor->upper = upper < compressor->upper ? upper : compressor->upper;
+	compressor->held_at = timestamp;
+	compressor->held_value = value;
+	return 0;
+}
+
+unsigned influx_compressor_flush(influx_compressor *compressor, long long *archived_at, double *archived)
+{
+	if (compressor == NULL || !compressor->held)
+	{
+		return 0;
+	}
+
+	compressor->held = 0;
+	compressor->at = compressor->held_at;
+	compressor->value = compressor->held_value;
+	*archived_at = compressor->at;
+	*archived = compressor->value;
+	return 1;
+}
+
+void influx_compressor_close(influx_compressor *compressor)
+{
+	free(compressor);
+}
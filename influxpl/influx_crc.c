@@ -0,0 +1,31 @@
+#include "./influx_internal.h"
+#include <pthread.h>
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void crc_init(void)
+{
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t c = i;
+		for (int k = 0; k < 8; k++)
+		{
+			c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+		}
+		crc_table[i] = c;
+	}
+}
+
+// the IEEE crc32 zlib computes
+uint32_t influx_crc32(uint32_t crc, const unsigned char *data, size_t length)
+{
+	pthread_once(&crc_once, crc_init);
+
+	crc = ~crc;
+	for (size_t i = 0; i < length; i++)
+	{
+		crc = crc_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return ~crc;
+}
@@ -0,0 +1,10 @@
+#ifndef _INFLUX_INTERNAL_H_
+#define _INFLUX_INTERNAL_H_
+
+#include "./influx.h"
+#include <stdint.h>
+
+// the IEEE crc32 zlib computes, chained through crc (0 to start)
+uint32_t influx_crc32(uint32_t crc, const unsigned char *data, size_t length);
+
+#endif // _INFLUX_INTERNAL_H_
@@ -0,0 +1,281 @@
+#include "./influx.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+influx_status influx_buffer_init(influx_buffer *buffer, size_t capacity)
+{
+	memset(buffer, 0, sizeof(*buffer));
+	buffer->data = malloc(capacity);
+	if (buffer->data == NULL)
+	{
+		return INFLUX_NOMEM;
+	}
+	buffer->capacity = capacity;
+	return INFLUX_OK;
+}
+
+void influx_buffer_reset(influx_buffer *buffer)
+{
+	buffer->length = 0;
+	buffer->points = 0;
+}
+
+void influx_buffer_free(influx_buffer *buffer)
+{
+	free(buffer->data);
+	memset(buffer, 0, sizeof(*buffer));
+}
+
+// copy s escaping the characters in special with a backslash, returns the length or 0 if it doesn't fit
+static size_t escape(char *out, size_t room, const char *s, const char *special)
+{
+	size_t n = 0;
+	for (; *s != '\0'; s++)
+	{
+		if (strchr(special, *s) != NULL)
+		{
+			if (n == room)
+			{
+				return 0;
+			}
+			out[n++] = '\\';
+		}
+		if (n == room)
+		{
+			return 0;
+		}
+		out[n++] = *s;
+	}
+	return n;
+}
+
+influx_status influx_series_init(influx_series *series, const char *measurement, const char *const *tags)
+{
+	memset(series, 0, sizeof(*series));
+	if (measurement == NULL || *measurement == '\0')
+	{
+		return INFLUX_INVALID;
+	}
+
+	size_t n = escape(series->prefix, INFLUX_PREFIX_MAX, measurement, ", ");
+	for (; n != 0 && tags != NULL && tags[0] != NULL; tags += 2)
+	{
+		if (tags[1] == NULL || *tags[0] == '\0' || *tags[1] == '\0' || n + 2 > INFLUX_PREFIX_MAX)
+		{
+			return INFLUX_INVALID;
+		}
+
+		series->prefix[n++] = ',';
+		size_t key = escape(series->prefix + n, INFLUX_PREFIX_MAX - n, tags[0], ",= ");
+		n = key != 0 && n + key < INFLUX_PREFIX_MAX ? n + key : 0;
+		if (n != 0)
+		{
+			series->prefix[n++] = '=';
+			size_t value = escape(series->prefix + n, INFLUX_PREFIX_MAX - n, tags[1], ",= ");
+			n = value != 0 ? n + value : 0;
+		}
+	}
+	if (n == 0)
+	{
+		return INFLUX_INVALID;
+	}
+
+	series->length = n;
+	return INFLUX_OK;
+}
+
+// decimal digits of value, returns the length
+static size_t format_unsigned(char *out, unsigned long long value)
+{
+	char digits[20];
+	size_t n = 0;
+	do
+	{
+		digits[n++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		out[i] = digits[n - 1 - i];
+	}
+	return n;
+}
+
+// width digits of value, zero padded, with trailing zeros dropped; returns the length (0 if value is 0)
+static size_t format_fraction(char *out, unsigned long long value, int width)
+{
+	while (width > 0 && value % 10 == 0)
+	{
+		value /= 10;
+		width--;
+	}
+	for (int i = width - 1; i >= 0; i--)
+	{
+		out[i] = (char)('0' + value % 10);
+		value /= 10;
+	}
+	return (size_t)width;
+}
+
+size_t influx_format_double(char *out, double value)
+{
+	_Static_assert(INFLUX_DIGITS == 15, "the exponent notation below writes 15 digits");
+
+	if (!isfinite(value))
+	{
+		return 0;
+	}
+
+	char *p = out;
+	if (value < 0)
+	{
+		*p++ = '-';
+		value = -value;
+	}
+
+	if (value < 9007199254740992.0 && value == floor(value))
+	{
+		p += format_unsigned(p, (unsigned long long)value);
+	}
+	else if (value >= 1e-4 && value < 1e9)
+	{
+		// as many decimals as leave INFLUX_DIGITS significant ones, from 6 below 1e9 to 18 at 1e-4; the fraction
+		// splits off exactly, and fma() gives the error of scaling it, so it rounds as the exact product would
+		int decimals = INFLUX_DIGITS - ((int)floor(log10(value)) + 1);
+		unsigned long long scale = 1;
+		for (int i = 0; i < decimals; i++)
+		{
+			scale *= 10;
+		}
+		double whole = floor(value);
+		double product = (value - whole) * (double)scale;
+		double error = fma(value - whole, (double)scale, -product);
+		double rounded = round(product);
+		double off = product - rounded + error;
+		rounded += off > 0.5 ? 1 : off < -0.5 ? -1 : 0;
+		unsigned long long integer = (unsigned long long)whole;
+		unsigned long long fraction = (unsigned long long)rounded;
+		if (fraction == scale)
+		{
+			integer++;
+			fraction = 0;
+		}
+		p += format_unsigned(p, integer);
+		if (fraction != 0)
+		{
+			*p++ = '.';
+			p += format_fraction(p, fraction, decimals);
+		}
+	}
+	else
+	{
+		// d.dddddddddddddde[+-]x, 15 significant digits, scaled in two steps so neither power overflows,
+		// and truncated rather than rounded at the top of the range so it can't round up to infinity
+		int exponent = (int)floor(log10(value));
+		double mantissa_value = value / pow(10, exponent / 2) / pow(10, exponent - exponent / 2) * 1e14;
+		unsigned long long mantissa = exponent >= 308 ? (unsigned long long)mantissa_value : (unsigned long long)llround(mantissa_value);
+		if (mantissa >= 1000000000000000ULL)
+		{
+			mantissa /= 10;
+			exponent++;
+		}
+		else if (mantissa < 100000000000000ULL)
+		{
+			mantissa *= 10;
+			exponent--;
+		}
+
+		*p++ = (char)('0' + mantissa / 100000000000000ULL);
+		unsigned long long rest = mantissa % 100000000000000ULL;
+		if (rest != 0)
+		{
+			*p++ = '.';
+			p += format_fraction(p, rest, 14);
+		}
+		*p++ = 'e';
+		*p++ = exponent < 0 ? '-' : '+';
+		p += format_unsigned(p, (unsigned long long)(exponent < 0 ? -exponent : exponent));
+	}
+
+	return (size_t)(p - out);
+}
+
+influx_status influx_point(influx_buffer *buffer, const influx_series *series, const char *const *keys, const double *values, unsigned integers, unsigned n, long long timestamp)
+{
+	if (series->length == 0 || n == 0 || n > 32 || timestamp < 0)
+	{
+		return INFLUX_INVALID;
+	}
+
+	// build the line in place and only commit it once it fits, so a full buffer is left as it was
+	char *line = buffer->data + buffer->length;
+	size_t room = buffer->capacity - buffer->length;
+	size_t length = series->length;
+	if (length + 1 > room)
+	{
+		return INFLUX_FULL;
+	}
+	memcpy(line, series->prefix, length);
+
+	for (unsigned i = 0; i < n; i++)
+	{
+		if (keys[i] == NULL || *keys[i] == '\0' || !isfinite(values[i]))
+		{
+			return INFLUX_INVALID;
+		}
+
+		// separator, the key, '=', and a value of at most 32 characters plus the 'i'
+		if (length + 1 > room)
+		{
+			return INFLUX_FULL;
+		}
+		line[length++] = i == 0 ? ' ' : ',';
+		size_t key = escape(line + length, room - length, keys[i], ",= ");
+		if (key == 0 || length + key + 1 + 33 > room)
+		{
+			return INFLUX_FULL;
+		}
+		length += key;
+		line[length++] = '=';
+		if (integers & (1u << i))
+		{
+			double value = values[i] < 0 ? -values[i] : values[i];
+			if (value >= 9223372036854775808.0)
+			{
+				return INFLUX_INVALID;
+			}
+			if (values[i] < 0)
+			{
+				line[length++] = '-';
+			}
+			length += format_unsigned(line + length, (unsigned long long)value);
+			line[length++] = 'i';
+		}
+		else
+		{
+			length += influx_format_double(line + length, values[i]);
+		}
+	}
+
+	if (timestamp != 0)
+	{
+		if (length + 1 + 20 > room)
+		{
+			return INFLUX_FULL;
+		}
+		line[length++] = ' ';
+		length += format_unsigned(line + length, (unsigned long long)timestamp);
+	}
+
+	if (length + 1 > room)
+	{
+		return INFLUX_FULL;
+	}
+	line[length++] = '\n';
+
+	buffer->length += length;
+	buffer->points++;
+	return INFLUX_OK;
+}
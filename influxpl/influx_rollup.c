@@ -0,0 +1,412 @@
+#include "./influx.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NS_PER_S 1000000000LL
+
+typedef struct
+{
+	unsigned long count;
+	double min;
+	double max;
+	double sum;
+	double last;
+} aggregate;
+
+struct influx_rollup
+{
+	pthread_mutex_t lock;
+	influx_writer *writer;
+	influx_series raw;
+	long long raw_ns;
+	long long raw_last; // timestamp of the latest raw point passed on, -1 before the first
+
+	unsigned nwindows;
+	long long windows[INFLUX_ROLLUP_WINDOWS]; // ns
+	influx_series series[INFLUX_ROLLUP_WINDOWS];
+	long long start[INFLUX_ROLLUP_WINDOWS];   // of the window being aggregated, -1 before the first sample
+
+	unsigned nchannels;
+	char channels[INFLUX_ROLLUP_CHANNELS][64];
+	aggregate aggregates[INFLUX_ROLLUP_WINDOWS][INFLUX_ROLLUP_CHANNELS];
+	influx_compressor *compressors[INFLUX_ROLLUP_CHANNELS]; // NULL for channels that keep to raw_ns
+	unsigned integers;                                      // bit c set for compressed channels that are integers
+	unsigned npassthrough;
+	char passthrough[INFLUX_ROLLUP_PASSTHROUGH][64];
+	// the passthrough fields of the sample each compressor saw last, the one it may hold back and keep later
+	double held[INFLUX_ROLLUP_CHANNELS][INFLUX_ROLLUP_PASSTHROUGH];
+	unsigned held_present[INFLUX_ROLLUP_CHANNELS]; // bit p set where that sample had passthrough key p
+	unsigned held_integers[INFLUX_ROLLUP_CHANNELS];
+	influx_rollup_info info;
+};
+
+influx_rollup *influx_rollup_open(influx_writer *writer, const char *measurement, const char *const *tags, const unsigned *windows, unsigned nwindows, unsigned raw_ms)
+{
+	if (writer == NULL || measurement == NULL || nwindows > INFLUX_ROLLUP_WINDOWS || (nwindows == 0 && raw_ms == 0))
+	{
+		return NULL;
+	}
+
+	influx_rollup *rollup = calloc(1, sizeof(*rollup));
+	if (rollup == NULL)
+	{
+		return NULL;
+	}
+	rollup->writer = writer;
+	rollup->raw_ns = (long long)raw_ms * 1000000;
+	rollup->raw_last = -1;
+	rollup->nwindows = nwindows;
+	if (influx_series_init(&rollup->raw, measurement, tags) != INFLUX_OK)
+	{
+		free(rollup);
+		return NULL;
+	}
+
+	// each window goes to its own measurement, e.g. measurement_15m
+	for (unsigned w = 0; w < nwindows; w++)
+	{
+		char name[INFLUX_PREFIX_MAX];
+		unsigned seconds = windows[w];
+		if (seconds == 0 || (w > 0 && seconds <= windows[w - 1]))
+		{
+			free(rollup);
+			return NULL;
+		}
+		if (seconds % 3600 == 0)
+		{
+			snprintf(name, sizeof(name), "%s_%uh", measurement, seconds / 3600);
+		}
+		else if (seconds % 60 == 0)
+		{
+			snprintf(name, sizeof(name), "%s_%um", measurement, seconds / 60);
+		}
+		else
+		{
+			snprintf(name, sizeof(name), "%s_%us", measurement, seconds);
+		}
+		if (influx_series_init(&rollup->series[w], name, tags) != INFLUX_OK)
+		{
+			free(rollup);
+			return NULL;
+		}
+		rollup->windows[w] = seconds * NS_PER_S;
+		rollup->start[w] = -1;
+	}
+
+	pthread_mutex_init(&rollup->lock, NULL);
+	return rollup;
+}
+
+// the passthrough key called key, -1 if it isn't one
+static int passthrough_of(influx_rollup *rollup, const char *key)
+{
+	for (unsigned p = 0; p < rollup->npassthrough; p++)
+	{
+		if (strcmp(rollup->passthrough[p], key) == 0)
+		{
+			return (int)p;
+		}
+	}
+	return -1;
+}
+
+// the channel called key, added on first sight; -1 once there is no room for it (or it is passed through)
+static int channel_of(influx_rollup *rollup, const char *key)
+{
+	if (passthrough_of(rollup, key) >= 0)
+	{
+		return -1;
+	}
+	for (unsigned c = 0; c < rollup->nchannels; c++)
+	{
+		if (strcmp(rollup->channels[c], key) == 0)
+		{
+			return (int)c;
+		}
+	}
+	if (rollup->nchannels == INFLUX_ROLLUP_CHANNELS || strlen(key) >= sizeof(rollup->channels[0]) - 8)
+	{
+		return -1;
+	}
+	strcpy(rollup->channels[rollup->nchannels], key);
+	return (int)rollup->nchannels++;
+}
+
+// write window w as one point, <channel>_min, _max, _mean, _count and _last for every channel it saw
+static influx_status emit(influx_rollup *rollup, unsigned w)
+{
+	char names[INFLUX_ROLLUP_CHANNELS * 5][72];
+	const char *keys[INFLUX_ROLLUP_CHANNELS * 5];
+	double values[INFLUX_ROLLUP_CHANNELS * 5];
+	unsigned integers = 0;
+	unsigned n = 0;
+
+	static const char *const suffixes[] = { "min", "max", "mean", "count", "last" };
+	for (unsigned c = 0; c < rollup->nchannels; c++)
+	{
+		aggregate *a = &rollup->aggregates[w][c];
+		if (a->count == 0)
+		{
+			continue;
+		}
+
+		double stats[] = { a->min, a->max, a->sum / a->count, (double)a->count, a->last };
+		for (unsigned s = 0; s < 5; s++)
+		{
+			snprintf(names[n], sizeof(names[n]), "%s_%s", rollup->channels[c], suffixes[s]);
+			keys[n] = names[n];
+			values[n] = stats[s];
+			integers |= s == 3 ? 1u << n : 0;
+			n++;
+		}
+		memset(a, 0, sizeof(*a));
+	}
+	if (n == 0)
+	{
+		return INFLUX_OK;
+	}
+
+	rollup->info.rollups++;
+	return influx_writer_point(rollup->writer, &rollup->series[w], keys, values, integers, n, rollup->start[w]);
+}
+
+influx_status influx_rollup_compress(influx_rollup *rollup, const char *key, influx_compression mode, double tolerance, unsigned heartbeat_ms)
+{
+	if (rollup == NULL || key == NULL)
+	{
+		return INFLUX_INVALID;
+	}
+
+	pthread_mutex_lock(&rollup->lock);
+	int c = channel_of(rollup, key);
+	influx_compressor *compressor = c < 0 ? NULL : influx_compressor_open(mode, tolerance, heartbeat_ms);
+	if (compressor != NULL)
+	{
+		influx_compressor_close(rollup->compressors[c]);
+		rollup->compressors[c] = compressor;
+	}
+	pthread_mutex_unlock(&rollup->lock);
+	return compressor != NULL ? INFLUX_OK : INFLUX_INVALID;
+}
+
+influx_status influx_rollup_passthrough(influx_rollup *rollup, const char *key)
+{
+	if (rollup == NULL || key == NULL || strlen(key) >= sizeof(rollup->passthrough[0]))
+	{
+		return INFLUX_INVALID;
+	}
+
+	// a key already aggregated as a channel stays one
+	influx_status rc = INFLUX_OK;
+	pthread_mutex_lock(&rollup->lock);
+	int channel = 0;
+	for (unsigned c = 0; c < rollup->nchannels; c++)
+	{
+		channel |= strcmp(rollup->channels[c], key) == 0;
+	}
+	if (channel || rollup->npassthrough == INFLUX_ROLLUP_PASSTHROUGH)
+	{
+		rc = INFLUX_INVALID;
+	}
+	else if (passthrough_of(rollup, key) < 0)
+	{
+		strcpy(rollup->passthrough[rollup->npassthrough++], key);
+	}
+	pthread_mutex_unlock(&rollup->lock);
+	return rc;
+}
+
+// write a sample compressor c kept as a point of the raw series with just that field and the passthrough
+// fields (present, integers: bit p for passthrough key p) the sample came with
+static influx_status keep(influx_rollup *rollup, unsigned c, long long timestamp, double value, const double *passthrough, unsigned present, unsigned integers)
+{
+	const char *keys[1 + INFLUX_ROLLUP_PASSTHROUGH] = { rollup->channels[c] };
+	double values[1 + INFLUX_ROLLUP_PASSTHROUGH] = { value };
+	unsigned kept_integers = rollup->integers >> c & 1;
+	unsigned n = 1;
+	for (unsigned p = 0; p < rollup->npassthrough; p++)
+	{
+		if (present >> p & 1)
+		{
+			keys[n] = rollup->passthrough[p];
+			values[n] = passthrough[p];
+			kept_integers |= (integers >> p & 1) << n;
+			n++;
+		}
+	}
+	rollup->info.kept++;
+	return influx_writer_point(rollup->writer, &rollup->raw, keys, values, kept_integers, n, timestamp);
+}
+
+influx_status influx_rollup_point(influx_rollup *rollup, const char *const *keys, const double *values, unsigned integers, unsigned n, long long timestamp)
+{
+	if (rollup == NULL || n == 0 || timestamp <= 0)
+	{
+		return INFLUX_INVALID;
+	}
+
+	influx_status rc = INFLUX_OK;
+	pthread_mutex_lock(&rollup->lock);
+	rollup->info.samples++;
+
+	// a late sample can't go into windows that are already written, it only counts towards the raw rate
+	int late = 0;
+	for (unsigned w = 0; w < rollup->nwindows; w++)
+	{
+		long long start = timestamp - timestamp % rollup->windows[w];
+		if (start < rollup->start[w])
+		{
+			late = 1;
+			continue;
+		}
+		if (start > rollup->start[w])
+		{
+			if (rollup->start[w] >= 0)
+			{
+				influx_status emitted = emit(rollup, w);
+				rc = rc == INFLUX_OK ? emitted : rc;
+			}
+			rollup->start[w] = start;
+		}
+
+		for (unsigned i = 0; i < n; i++)
+		{
+			int c = channel_of(rollup, keys[i]);
+			if (c < 0 || values[i] != values[i])
+			{
+				continue;
+			}
+			aggregate *a = &rollup->aggregates[w][c];
+			if (a->count == 0 || values[i] < a->min)
+			{
+				a->min = values[i];
+			}
+			if (a->count == 0 || values[i] > a->max)
+			{
+				a->max = values[i];
+			}
+			a->sum += values[i];
+			a->last = values[i];
+			a->count++;
+		}
+	}
+
+	rollup->info.late += (unsigned long)late;
+
+	double passthrough[INFLUX_ROLLUP_PASSTHROUGH];
+	unsigned present = 0;
+	unsigned passthrough_integers = 0;
+	for (unsigned i = 0; i < n; i++)
+	{
+		int p = passthrough_of(rollup, keys[i]);
+		if (p >= 0)
+		{
+			passthrough[p] = values[i];
+			present |= 1u << p;
+			passthrough_integers |= (integers >> i & 1) << p;
+		}
+	}
+
+	// compressed channels go out when their compressor keeps a sample, the rest at the reduced rate, as they came;
+	// passthrough fields go along with both, but a raw point of nothing else isn't worth writing
+	const char *raw_keys[32];
+	double raw_values[32];
+	unsigned raw_integers = 0;
+	unsigned m = 0;
+	unsigned measured = 0;
+	for (unsigned i = 0; i < n && m < 32; i++)
+	{
+		int c = channel_of(rollup, keys[i]);
+		if (c >= 0 && rollup->compressors[c] != NULL)
+		{
+			long long at;
+			double kept;
+			rollup->integers = (rollup->integers & ~(1u << c)) | (integers >> i & 1) << c;
+			if (influx_compressor_sample(rollup->compressors[c], timestamp, values[i], &at, &kept))
+			{
+				// a sample held back is the one this compressor saw before
+				influx_status written = at == timestamp ? keep(rollup, (unsigned)c, at, kept, passthrough, present, passthrough_integers)
+				                                        : keep(rollup, (unsigned)c, at, kept, rollup->held[c], rollup->held_present[c], rollup->held_integers[c]);
+				rc = rc == INFLUX_OK ? written : rc;
+			}
+			memcpy(rollup->held[c], passthrough, sizeof(passthrough));
+			rollup->held_present[c] = present;
+			rollup->held_integers[c] = passthrough_integers;
+			continue;
+		}
+		measured += passthrough_of(rollup, keys[i]) < 0;
+		raw_keys[m] = keys[i];
+		raw_values[m] = values[i];
+		raw_integers |= (integers >> i & 1) << m;
+		m++;
+	}
+	if (measured > 0 && rollup->raw_ns > 0 && (rollup->raw_last < 0 || timestamp - rollup->raw_last >= rollup->raw_ns))
+	{
+		rollup->raw_last = timestamp;
+		rollup->info.raw++;
+		influx_status written = influx_writer_point(rollup->writer, &rollup->raw, raw_keys, raw_values, raw_integers, m, timestamp);
+		rc = rc == INFLUX_OK ? written : rc;
+	}
+	pthread_mutex_unlock(&rollup->lock);
+	return rc;
+}
+
+void influx_rollup_flush(influx_rollup *rollup)
+{
+	if (rollup == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&rollup->lock);
+	for (unsigned w = 0; w < rollup->nwindows; w++)
+	{
+		// a window is only written once: samples that still fall into a flushed one are late
+		if (rollup->start[w] >= 0)
+		{
+			emit(rollup, w);
+			rollup->start[w] += rollup->windows[w];
+		}
+	}
+	for (unsigned c = 0; c < rollup->nchannels; c++)
+	{
+		long long at;
+		double kept;
+		if (influx_compressor_flush(rollup->compressors[c], &at, &kept))
+		{
+			keep(rollup, c, at, kept, rollup->held[c], rollup->held_present[c], rollup->held_integers[c]);
+		}
+	}
+	pthread_mutex_unlock(&rollup->lock);
+}
+
+void influx_rollup_status(influx_rollup *rollup, influx_rollup_info *info)
+{
+	memset(info, 0, sizeof(*info));
+	if (rollup == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&rollup->lock);
+	*info = rollup->info;
+	pthread_mutex_unlock(&rollup->lock);
+}
+
+void influx_rollup_close(influx_rollup *rollup)
+{
+	if (rollup == NULL)
+	{
+		return;
+	}
+
+	influx_rollup_flush(rollup);
+	for (unsigned c = 0; c < rollup->nchannels; c++)
+	{
+		influx_compressor_close(rollup->compressors[c]);
+	}
+	pthread_mutex_destroy(&rollup->lock);
+	free(rollup);
+}
@@ -0,0 +1,620 @@
+#include "./influx_internal.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+   * The spool is a directory of segment files named after their (hexadecimal) sequence number, each
+   * segment_bytes long and mapped shared, holding records back to back: a spool_record followed by the
+   * line protocol of one point, padded to 8 bytes. A fresh segment is all zeros, so the first zero magic
+   * (or a checksum that doesn't match, after a power loss took some pages and not others) ends it.
+   *
+   * Segments are only ever appended to by the run that created them; after a restart the recovered ones are
+   * read-only and appends start a new segment, so whatever follows a damaged record can never be mistaken
+   * for part of the log later on.
+   *
+   * The read position lives in the cursor file, in two slots a sector apart that are written alternately,
+   * so a torn write can only lose the latest commit (and have its points sent again).
+*/
+#define SPOOL_MAGIC 0x4c415749 // "IWAL"
+#define CURSOR_MAGIC 0x52534349 // "ICSR"
+#define CURSOR_SLOT 512
+#define ALIGN(n) (((n) + 7) & ~(size_t)7)
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t length;
+	uint32_t crc; // crc32 of length and the line
+	uint32_t reserved;
+} spool_record;
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t crc; // crc32 of the fields below
+	uint64_t sequence;
+	uint64_t segment;
+	uint64_t offset;
+} spool_cursor;
+
+typedef struct
+{
+	uint64_t id;
+	unsigned char *map;
+	size_t end;    // length of the valid records
+	size_t synced; // how much of them msync() has written out
+} segment;
+
+struct influx_spool
+{
+	pthread_mutex_t lock;
+	char *directory;
+	int directory_fd;
+	int cursor_fd;
+	uint64_t cursor_sequence;
+	uint64_t next_id; // ids only grow, or a stale cursor could take a new segment for a consumed one
+	size_t segment_bytes;
+	unsigned max_segments;
+
+	// oldest first, the last one takes appends once writable is set
+	segment *segments;
+	unsigned nsegments;
+	int writable;
+
+	// read position, and where the last influx_spool_peek() ended
+	unsigned cursor_index;
+	size_t cursor_offset;
+	uint64_t peek_segment;
+	size_t peek_offset;
+	unsigned long peek_records;
+	size_t peek_bytes;
+	int peeked;
+
+	influx_spool_info info;
+};
+
+static uint32_t record_crc(uint32_t length, const unsigned char *line)
+{
+	return influx_crc32(influx_crc32(0, (const unsigned char *)&length, sizeof(length)), line, length);
+}
+
+// the record at offset, or NULL if there isn't a valid one
+static const spool_record *record_at(const influx_spool *spool, const segment *s, size_t offset)
+{
+	if (offset + sizeof(spool_record) > spool->segment_bytes)
+	{
+		return NULL;
+	}
+	const spool_record *record = (const spool_record *)(s->map + offset);
+	if (record->magic != SPOOL_MAGIC || record->length == 0 || offset + sizeof(spool_record) + record->length > spool->segment_bytes)
+	{
+		return NULL;
+	}
+	if (record->crc != record_crc(record->length, s->map + offset + sizeof(spool_record)))
+	{
+		return NULL;
+	}
+	return record;
+}
+
+static void segment_path(const influx_spool *spool, uint64_t id, char *path, size_t size)
+{
+	snprintf(path, size, "%s/%016llx.wal", spool->directory, (unsigned long long)id);
+}
+
+// map segment id, creating it (all zeros) if create is set
+static int map_segment(influx_spool *spool, uint64_t id, int create, segment *s)
+{
+	char path[4096];
+	segment_path(spool, id, path, sizeof(path));
+
+	int fd = open(path, O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0), 0600);
+	if (fd < 0)
+	{
+		perror("*** influx spool: open segment");
+		return -1;
+	}
+	if (create && ftruncate(fd, (off_t)spool->segment_bytes) != 0)
+	{
+		perror("*** influx spool: ftruncate");
+		close(fd);
+		unlink(path);
+		return -1;
+	}
+
+	void *map = mmap(NULL, spool->segment_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		perror("*** influx spool: mmap");
+		if (create)
+		{
+			unlink(path);
+		}
+		return -1;
+	}
+
+	memset(s, 0, sizeof(*s));
+	s->id = id;
+	s->map = map;
+	return 0;
+}
+
+// unmap and delete the oldest segment
+static void drop_oldest(influx_spool *spool)
+{
+	char path[4096];
+	segment_path(spool, spool->segments[0].id, path, sizeof(path));
+	munmap(spool->segments[0].map, spool->segment_bytes);
+	unlink(path);
+
+	spool->nsegments--;
+	memmove(spool->segments, spool->segments + 1, spool->nsegments * sizeof(segment));
+	spool->cursor_index--;
+}
+
+static void write_cursor(influx_spool *spool)
+{
+	spool_cursor cursor = { CURSOR_MAGIC, 0, ++spool->cursor_sequence, spool->segments[spool->cursor_index].id, spool->cursor_offset };
+	cursor.crc = influx_crc32(0, (const unsigned char *)&cursor.sequence, sizeof(cursor) - offsetof(spool_cursor, sequence));
+
+	off_t slot = (off_t)(cursor.sequence % 2) * CURSOR_SLOT;
+	if (pwrite(spool->cursor_fd, &cursor, sizeof(cursor), slot) != sizeof(cursor) || fdatasync(spool->cursor_fd) != 0)
+	{
+		perror("*** influx spool: cursor");
+	}
+}
+
+// the valid cursor slot with the highest sequence, 0 if there is none
+static int read_cursor(influx_spool *spool, spool_cursor *latest)
+{
+	int found = 0;
+	for (int slot = 0; slot < 2; slot++)
+	{
+		spool_cursor cursor;
+		if (pread(spool->cursor_fd, &cursor, sizeof(cursor), (off_t)slot * CURSOR_SLOT) != sizeof(cursor) || cursor.magic != CURSOR_MAGIC)
+		{
+			continue;
+		}
+		if (cursor.crc != influx_crc32(0, (const unsigned char *)&cursor.sequence, sizeof(cursor) - offsetof(spool_cursor, sequence)))
+		{
+			continue;
+		}
+		if (!found || cursor.sequence > latest->sequence)
+		{
+			*latest = cursor;
+			found = 1;
+		}
+	}
+	return found;
+}
+
+// records and line bytes of segment s from offset on
+static void count_from(const segment *s, size_t offset, unsigned long *records, unsigned long *bytes)
+{
+	while (offset < s->end)
+	{
+		const spool_record *record = (const spool_record *)(s->map + offset);
+		(*records)++;
+		*bytes += record->length;
+		offset += ALIGN(sizeof(spool_record) + record->length);
+	}
+}
+
+static int compare_ids(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+// map every segment a previous run left behind and find where its records end
+static int recover(influx_spool *spool)
+{
+	DIR *dir = fdopendir(dup(spool->directory_fd));
+	if (dir == NULL)
+	{
+		return -1;
+	}
+
+	uint64_t *ids = NULL;
+	unsigned nids = 0, capacity = 0;
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		char *end;
+		unsigned long long id = strtoull(entry->d_name, &end, 16);
+		if (end - entry->d_name != 16 || strcmp(end, ".wal") != 0)
+		{
+			continue;
+		}
+		if (nids == capacity)
+		{
+			capacity = capacity ? capacity * 2 : 16;
+			uint64_t *grown = realloc(ids, capacity * sizeof(uint64_t));
+			if (grown == NULL)
+			{
+				break;
+			}
+			ids = grown;
+		}
+		ids[nids++] = id;
+	}
+	closedir(dir);
+	qsort(ids, nids, sizeof(uint64_t), compare_ids);
+
+	spool_cursor cursor;
+	int has_cursor = read_cursor(spool, &cursor);
+	if (has_cursor)
+	{
+		spool->cursor_sequence = cursor.sequence;
+		spool->next_id = cursor.segment + 1;
+	}
+	if (nids > 0 && ids[nids - 1] >= spool->next_id)
+	{
+		spool->next_id = ids[nids - 1] + 1;
+	}
+
+	for (unsigned i = 0; i < nids; i++)
+	{
+		char path[4096];
+		segment_path(spool, ids[i], path, sizeof(path));
+
+		// consumed before the last run could delete it, or too many to keep
+		if ((has_cursor && ids[i] < cursor.segment) || nids - i > spool->max_segments)
+		{
+			unlink(path);
+			continue;
+		}
+
+		segment *s = &spool->segments[spool->nsegments];
+		if (map_segment(spool, ids[i], 0, s) != 0)
+		{
+			continue;
+		}
+		size_t offset = 0;
+		const spool_record *record;
+		while ((record = record_at(spool, s, offset)) != NULL)
+		{
+			offset += ALIGN(sizeof(spool_record) + record->length);
+		}
+		if (offset < spool->segment_bytes && s->map[offset] != 0)
+		{
+			spool->info.damaged++;
+		}
+		if (offset == 0)
+		{
+			munmap(s->map, spool->segment_bytes);
+			unlink(path);
+			continue;
+		}
+		s->end = offset;
+		s->synced = offset;
+		spool->nsegments++;
+	}
+	free(ids);
+
+	// the cursor only counts if its segment is still there, otherwise reading starts with the oldest one
+	spool->cursor_index = 0;
+	spool->cursor_offset = 0;
+	if (has_cursor && spool->nsegments > 0 && spool->segments[0].id == cursor.segment)
+	{
+		spool->cursor_offset = cursor.offset < spool->segments[0].end ? cursor.offset : spool->segments[0].end;
+	}
+
+	for (unsigned i = 0; i < spool->nsegments; i++)
+	{
+		count_from(&spool->segments[i], i == 0 ? spool->cursor_offset : 0, &spool->info.backlog, &spool->info.bytes);
+	}
+	spool->info.records = spool->info.backlog;
+	return 0;
+}
+
+influx_spool *influx_spool_open(const char *directory, size_t segment_bytes, size_t max_bytes)
+{
+	if (directory == NULL || segment_bytes < 4096 || segment_bytes % 4096 != 0 || segment_bytes > UINT32_MAX)
+	{
+		return NULL;
+	}
+
+	influx_spool *spool = calloc(1, sizeof(*spool));
+	if (spool == NULL)
+	{
+		return NULL;
+	}
+	spool->directory_fd = -1;
+	spool->cursor_fd = -1;
+	spool->segment_bytes = segment_bytes;
+	spool->max_segments = max_bytes / segment_bytes > 2 ? (unsigned)(max_bytes / segment_bytes) : 2;
+	spool->directory = strdup(directory);
+	spool->segments = calloc(spool->max_segments + 1, sizeof(segment));
+	pthread_mutex_init(&spool->lock, NULL);
+
+	if (spool->directory == NULL || spool->segments == NULL)
+	{
+		influx_spool_close(spool);
+		return NULL;
+	}
+
+	char path[4096];
+	snprintf(path, sizeof(path), "%s/cursor", directory);
+	if ((mkdir(directory, 0700) != 0 && errno != EEXIST) || (spool->directory_fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0 || (spool->cursor_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600)) < 0)
+	{
+		fprintf(stderr, "*** influx_spool_open failed: %s (%s)!\n", directory, strerror(errno));
+		influx_spool_close(spool);
+		return NULL;
+	}
+
+	// two processes appending to the same segments would overwrite each other's records; the lock goes with the fd
+	if (flock(spool->directory_fd, LOCK_EX | LOCK_NB) != 0)
+	{
+		fprintf(stderr, "*** influx_spool_open failed: %s is in use by another process!\n", directory);
+		influx_spool_close(spool);
+		return NULL;
+	}
+
+	if (recover(spool) != 0)
+	{
+		fprintf(stderr, "*** influx_spool_open failed: could not read %s!\n", directory);
+		influx_spool_close(spool);
+		return NULL;
+	}
+	return spool;
+}
+
+// start a new segment for appends, evicting the oldest one (and whatever wasn't sent from it) at the cap
+static influx_status roll(influx_spool *spool)
+{
+	if (spool->nsegments == spool->max_segments)
+	{
+		unsigned long records = 0;
+		unsigned long bytes = 0;
+		count_from(&spool->segments[0], spool->cursor_index == 0 ? spool->cursor_offset : spool->segments[0].end, &records, &bytes);
+		spool->info.evicted += records;
+		spool->info.backlog -= records;
+		spool->info.bytes -= bytes;
+
+		// a batch read from the evicted segment can't be committed, its points are sent again after the next peek
+		if (spool->peeked && spool->peek_segment >= spool->segments[0].id)
+		{
+			spool->peeked = 0;
+		}
+		if (spool->cursor_index == 0)
+		{
+			spool->cursor_index = 1;
+			spool->cursor_offset = 0;
+		}
+		drop_oldest(spool);
+	}
+
+	if (map_segment(spool, spool->next_id++, 1, &spool->segments[spool->nsegments]) != 0)
+	{
+		return INFLUX_NOMEM;
+	}
+	spool->nsegments++;
+	spool->writable = 1;
+
+	// the new file has to survive a power loss too
+	fsync(spool->directory_fd);
+	return INFLUX_OK;
+}
+
+influx_status influx_spool_append(influx_spool *spool, const char *line, size_t length)
+{
+	if (spool == NULL || length == 0 || ALIGN(sizeof(spool_record) + length) > spool->segment_bytes)
+	{
+		return INFLUX_INVALID;
+	}
+
+	pthread_mutex_lock(&spool->lock);
+	segment *s = spool->writable ? &spool->segments[spool->nsegments - 1] : NULL;
+	size_t size = ALIGN(sizeof(spool_record) + length);
+	if (s == NULL || s->end + size > spool->segment_bytes)
+	{
+		influx_status rc = roll(spool);
+		if (rc != INFLUX_OK)
+		{
+			pthread_mutex_unlock(&spool->lock);
+			return rc;
+		}
+		s = &spool->segments[spool->nsegments - 1];
+	}
+
+	// the line before the header, so the magic is the last thing to land in the page cache
+	spool_record record = { 0, (uint32_t)length, record_crc((uint32_t)length, (const unsigned char *)line), 0 };
+	memcpy(s->map + s->end + sizeof(spool_record), line, length);
+	memcpy(s->map + s->end + sizeof(uint32_t), (const char *)&record + sizeof(uint32_t), sizeof(record) - sizeof(uint32_t));
+	__atomic_store_n((uint32_t *)(s->map + s->end), SPOOL_MAGIC, __ATOMIC_RELEASE);
+	s->end += size;
+
+	spool->info.records++;
+	spool->info.backlog++;
+	spool->info.bytes += length;
+	pthread_mutex_unlock(&spool->lock);
+	return INFLUX_OK;
+}
+
+unsigned influx_spool_peek(influx_spool *spool, influx_buffer *buffer)
+{
+	if (spool == NULL)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&spool->lock);
+	unsigned index = spool->cursor_index;
+	size_t offset = spool->cursor_offset;
+	unsigned long records = 0;
+	size_t bytes = 0;
+	while (index < spool->nsegments)
+	{
+		const segment *s = &spool->segments[index];
+		if (offset >= s->end)
+		{
+			// on to the next segment, if this one is done with
+			if (index + 1 == spool->nsegments)
+			{
+				break;
+			}
+			index++;
+			offset = 0;
+			continue;
+		}
+
+		const spool_record *record = (const spool_record *)(s->map + offset);
+		if (buffer->length + record->length > buffer->capacity)
+		{
+			break;
+		}
+		memcpy(buffer->data + buffer->length, s->map + offset + sizeof(spool_record), record->length);
+		buffer->length += record->length;
+		buffer->points++;
+		records++;
+		bytes += record->length;
+		offset += ALIGN(sizeof(spool_record) + record->length);
+	}
+
+	spool->peeked = records > 0;
+	spool->peek_segment = index < spool->nsegments ? spool->segments[index].id : 0;
+	spool->peek_offset = offset;
+	spool->peek_records = records;
+	spool->peek_bytes = bytes;
+	pthread_mutex_unlock(&spool->lock);
+	return (unsigned)records;
+}
+
+void influx_spool_commit(influx_spool *spool)
+{
+	if (spool == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&spool->lock);
+	if (spool->peeked)
+	{
+		unsigned index = spool->cursor_index;
+		while (index < spool->nsegments && spool->segments[index].id != spool->peek_segment)
+		{
+			index++;
+		}
+		spool->cursor_index = index;
+		spool->cursor_offset = spool->peek_offset;
+		spool->info.backlog -= spool->peek_records;
+		spool->info.bytes -= spool->peek_bytes;
+		spool->info.committed += spool->peek_records;
+		spool->peeked = 0;
+
+		// a fully read segment is only deleted once the cursor past it is on disk
+		write_cursor(spool);
+		int dropped = 0;
+		while (spool->cursor_index > 0)
+		{
+			drop_oldest(spool);
+			dropped = 1;
+		}
+		if (dropped)
+		{
+			fsync(spool->directory_fd);
+		}
+	}
+	pthread_mutex_unlock(&spool->lock);
+}
+
+void influx_spool_sync(influx_spool *spool)
+{
+	if (spool == NULL)
+	{
+		return;
+	}
+
+	// msync() outside the lock so appends don't wait for the disk; the segments it covers can at worst
+	// be evicted meanwhile, which only makes msync() fail
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	for (;;)
+	{
+		pthread_mutex_lock(&spool->lock);
+		segment *s = NULL;
+		for (unsigned i = 0; i < spool->nsegments && s == NULL; i++)
+		{
+			if (spool->segments[i].synced < spool->segments[i].end)
+			{
+				s = &spool->segments[i];
+			}
+		}
+		if (s == NULL)
+		{
+			pthread_mutex_unlock(&spool->lock);
+			return;
+		}
+		unsigned char *map = s->map;
+		size_t from = s->synced & ~(page - 1);
+		size_t to = s->end;
+		s->synced = to;
+		pthread_mutex_unlock(&spool->lock);
+
+		msync(map + from, to - from, MS_SYNC);
+	}
+}
+
+size_t influx_spool_backlog(influx_spool *spool)
+{
+	if (spool == NULL)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&spool->lock);
+	size_t bytes = spool->info.bytes;
+	pthread_mutex_unlock(&spool->lock);
+	return bytes;
+}
+
+void influx_spool_status(influx_spool *spool, influx_spool_info *info)
+{
+	memset(info, 0, sizeof(*info));
+	if (spool == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&spool->lock);
+	*info = spool->info;
+	info->segments = spool->nsegments;
+	pthread_mutex_unlock(&spool->lock);
+}
+
+void influx_spool_close(influx_spool *spool)
+{
+	if (spool == NULL)
+	{
+		return;
+	}
+
+	influx_spool_sync(spool);
+	for (unsigned i = 0; i < spool->nsegments; i++)
+	{
+		munmap(spool->segments[i].map, spool->segment_bytes);
+	}
+	if (spool->cursor_fd >= 0)
+	{
+		close(spool->cursor_fd);
+	}
+	if (spool->directory_fd >= 0)
+	{
+		close(spool->directory_fd);
+	}
+	pthread_mutex_destroy(&spool->lock);
+	free(spool->segments);
+	free(spool->directory);
+	free(spool);
+}
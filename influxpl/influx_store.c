@@ -0,0 +1,629 @@
+#include "./influx_internal.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/*
+   * A store file is a ring of INFLUX_STORE_BLOCK byte blocks, mapped shared. Each block is a store_block header
+   * followed by a bit stream of the points after its first (whose timestamp is in the header and whose value
+   * opens the stream, raw):
+   *
+   *     timestamp  delta of delta from the previous point, in ms
+   *                '0' for 0, '10' + 7 bits, '110' + 9 bits, '1110' + 12 bits, '1111' + 32 bits (two's complement)
+   *     value      xor with the previous value's bits
+   *                '0' for the same value, '10' + the meaningful bits if they fit the previous window,
+   *                '11' + 5 bits of leading zeros + 6 bits of length - 1 + the meaningful bits otherwise
+   *
+   * The header's count only moves once the point's bits are in, so a crash mid-append loses that point and
+   * nothing else: the head's count is all that is trusted on open, its bits, last, min, max and sum are rebuilt
+   * from decoding that many points. Blocks are checksummed as they fill up, and one that doesn't check out is
+   * dropped on open. The block with the highest sequence is the head; a full head moves on to the next slot,
+   * overwriting the oldest block.
+   *
+   * A read-only store maps the file privately, so whatever open drops or rebuilds only changes its own copy.
+*/
+#define STORE_MAGIC 0x42445354 // "TSDB"
+#define MAX_POINT_BITS (4 + 32 + 2 + 5 + 6 + 64)
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t count;
+	uint64_t sequence;
+	int64_t first; // ms
+	int64_t last;
+	int64_t min_at;
+	int64_t max_at;
+	double min;
+	double max;
+	double sum;
+	uint32_t bits;
+	uint32_t crc; // crc32 of the stream, set once the next block is started
+} store_block;
+
+#define STREAM_BITS ((INFLUX_STORE_BLOCK - sizeof(store_block)) * 8)
+
+// where decoding (or encoding) of a block stands after its latest point
+typedef struct
+{
+	uint32_t position;
+	int64_t timestamp;
+	int64_t delta;
+	uint64_t value;
+	int leading;
+	int trailing;
+} codec;
+
+struct influx_store
+{
+	pthread_mutex_t lock;
+	unsigned char *map;
+	unsigned nblocks;
+	int readonly;
+	int head; // slot of the newest block, -1 while empty
+	codec state;
+};
+
+static store_block *block_at(const influx_store *store, unsigned slot)
+{
+	return (store_block *)(store->map + (size_t)slot * INFLUX_STORE_BLOCK);
+}
+
+static unsigned char *stream_of(store_block *block)
+{
+	return (unsigned char *)(block + 1);
+}
+
+static void put_bits(unsigned char *stream, uint32_t *position, uint64_t value, int n)
+{
+	while (n > 0)
+	{
+		uint32_t byte = *position / 8;
+		int room = 8 - (int)(*position % 8);
+		int take = n < room ? n : room;
+		unsigned bits = (unsigned)(value >> (n - take)) & ((1u << take) - 1);
+		if (room == 8)
+		{
+			stream[byte] = 0;
+		}
+		stream[byte] |= (unsigned char)(bits << (room - take));
+		*position += (uint32_t)take;
+		n -= take;
+	}
+}
+
+static uint64_t get_bits(const unsigned char *stream, uint32_t *position, int n)
+{
+	uint64_t value = 0;
+	while (n > 0)
+	{
+		uint32_t byte = *position / 8;
+		int room = 8 - (int)(*position % 8);
+		int take = n < room ? n : room;
+		unsigned bits = (stream[byte] >> (room - take)) & ((1u << take) - 1);
+		value = (value << take) | bits;
+		*position += (uint32_t)take;
+		n -= take;
+	}
+	return value;
+}
+
+static uint64_t double_bits(double value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static double bits_double(uint64_t bits)
+{
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static int64_t sign_extend(uint64_t value, int n)
+{
+	uint64_t sign = 1ULL << (n - 1);
+	return (int64_t)((value ^ sign) - sign);
+}
+
+// encode a point after the first, returns 0 if the delta of delta doesn't fit
+static int encode(unsigned char *stream, codec *state, int64_t timestamp, uint64_t value)
+{
+	int64_t delta = timestamp - state->timestamp;
+	int64_t dod = delta - state->delta;
+	if (dod == 0)
+	{
+		put_bits(stream, &state->position, 0, 1);
+	}
+	else if (dod >= -64 && dod <= 63)
+	{
+		put_bits(stream, &state->position, 2, 2);
+		put_bits(stream, &state->position, (uint64_t)dod, 7);
+	}
+	else if (dod >= -256 && dod <= 255)
+	{
+		put_bits(stream, &state->position, 6, 3);
+		put_bits(stream, &state->position, (uint64_t)dod, 9);
+	}
+	else if (dod >= -2048 && dod <= 2047)
+	{
+		put_bits(stream, &state->position, 14, 4);
+		put_bits(stream, &state->position, (uint64_t)dod, 12);
+	}
+	else if (dod >= INT32_MIN && dod <= INT32_MAX)
+	{
+		put_bits(stream, &state->position, 15, 4);
+		put_bits(stream, &state->position, (uint64_t)dod, 32);
+	}
+	else
+	{
+		return 0;
+	}
+	state->timestamp = timestamp;
+	state->delta = delta;
+
+	uint64_t xor = value ^ state->value;
+	if (xor == 0)
+	{
+		put_bits(stream, &state->position, 0, 1);
+	}
+	else
+	{
+		int leading = __builtin_clzll(xor);
+		int trailing = __builtin_ctzll(xor);
+		leading = leading > 31 ? 31 : leading;
+		if (state->leading >= 0 && leading >= state->leading && trailing >= state->trailing)
+		{
+			put_bits(stream, &state->position, 2, 2);
+			put_bits(stream, &state->position, xor >> state->trailing, 64 - state->leading - state->trailing);
+		}
+		else
+		{
+			int significant = 64 - leading - trailing;
+			put_bits(stream, &state->position, 3, 2);
+			put_bits(stream, &state->position, (uint64_t)leading, 5);
+			put_bits(stream, &state->position, (uint64_t)(significant - 1), 6);
+			put_bits(stream, &state->position, xor >> trailing, significant);
+			state->leading = leading;
+			state->trailing = trailing;
+		}
+	}
+	state->value = value;
+	return 1;
+}
+
+// decode the point after state into it, returns 0 if the stream doesn't make sense
+static int decode(const unsigned char *stream, codec *state)
+{
+	if (state->position + MAX_POINT_BITS > STREAM_BITS)
+	{
+		return 0;
+	}
+
+	int64_t dod = 0;
+	if (get_bits(stream, &state->position, 1) != 0)
+	{
+		if (get_bits(stream, &state->position, 1) == 0)
+		{
+			dod = sign_extend(get_bits(stream, &state->position, 7), 7);
+		}
+		else if (get_bits(stream, &state->position, 1) == 0)
+		{
+			dod = sign_extend(get_bits(stream, &state->position, 9), 9);
+		}
+		else if (get_bits(stream, &state->position, 1) == 0)
+		{
+			dod = sign_extend(get_bits(stream, &state->position, 12), 12);
+		}
+		else
+		{
+			dod = sign_extend(get_bits(stream, &state->position, 32), 32);
+		}
+	}
+	state->delta += dod;
+	state->timestamp += state->delta;
+
+	if (get_bits(stream, &state->position, 1) != 0)
+	{
+		if (get_bits(stream, &state->position, 1) != 0)
+		{
+			state->leading = (int)get_bits(stream, &state->position, 5);
+			int significant = (int)get_bits(stream, &state->position, 6) + 1;
+			state->trailing = 64 - state->leading - significant;
+		}
+		int significant = 64 - state->leading - state->trailing;
+		if (state->leading < 0 || state->trailing < 0)
+		{
+			return 0;
+		}
+		state->value ^= get_bits(stream, &state->position, significant) << state->trailing;
+	}
+	return 1;
+}
+
+// start decoding a block, at its first point
+static void decode_first(store_block *block, codec *state)
+{
+	memset(state, 0, sizeof(*state));
+	state->timestamp = block->first;
+	state->value = get_bits(stream_of(block), &state->position, 64);
+	state->leading = -1;
+}
+
+// whether a block has points and its stream holds as many as its header says, decoding them into state
+static int block_decodes(const influx_store *store, unsigned slot, codec *state)
+{
+	store_block *block = block_at(store, slot);
+	if (block->magic != STORE_MAGIC || block->count == 0)
+	{
+		return 0;
+	}
+
+	decode_first(block, state);
+	for (uint32_t i = 1; i < block->count; i++)
+	{
+		if (!decode(stream_of(block), state))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// a full block is valid if its header and checksum match its points to the bit
+static int block_valid(const influx_store *store, unsigned slot)
+{
+	store_block *block = block_at(store, slot);
+	codec state;
+	return block_decodes(store, slot, &state) && state.position == block->bits && state.timestamp == block->last && block->crc == influx_crc32(0, stream_of(block), (block->bits + 7) / 8);
+}
+
+// set the head's header from its count points, and clear what a torn append left after them in the stream
+static void rebuild_head(influx_store *store)
+{
+	store_block *block = block_at(store, (unsigned)store->head);
+	decode_first(block, &store->state);
+	block->min = block->max = block->sum = bits_double(store->state.value);
+	block->min_at = block->max_at = block->first;
+	for (uint32_t i = 1; i < block->count; i++)
+	{
+		decode(stream_of(block), &store->state);
+		double value = bits_double(store->state.value);
+		if (value < block->min)
+		{
+			block->min = value;
+			block->min_at = store->state.timestamp;
+		}
+		if (value > block->max)
+		{
+			block->max = value;
+			block->max_at = store->state.timestamp;
+		}
+		block->sum += value;
+	}
+	block->last = store->state.timestamp;
+	block->bits = store->state.position;
+
+	// the next point is or'ed into the byte the last one ends in
+	if (block->bits % 8 != 0)
+	{
+		stream_of(block)[block->bits / 8] &= (unsigned char)(0xff00 >> (block->bits % 8));
+	}
+}
+
+static influx_store *open_store(const char *path, unsigned blocks, int readonly)
+{
+	int fd = open(path, readonly ? O_RDONLY | O_CLOEXEC : O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (fd < 0)
+	{
+		perror("*** influx_store_open");
+		return NULL;
+	}
+
+	// an existing store keeps the size it was created with
+	off_t size = lseek(fd, 0, SEEK_END);
+	if (size > 0 && size % INFLUX_STORE_BLOCK == 0)
+	{
+		blocks = (unsigned)(size / INFLUX_STORE_BLOCK);
+	}
+	else if (readonly)
+	{
+		fprintf(stderr, "*** influx_store_open_readonly failed: %s is not a store!\n", path);
+		close(fd);
+		return NULL;
+	}
+	else if (ftruncate(fd, (off_t)blocks * INFLUX_STORE_BLOCK) != 0)
+	{
+		perror("*** influx_store_open: ftruncate");
+		close(fd);
+		return NULL;
+	}
+
+	void *map = mmap(NULL, (size_t)blocks * INFLUX_STORE_BLOCK, PROT_READ | PROT_WRITE, readonly ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		perror("*** influx_store_open: mmap");
+		return NULL;
+	}
+
+	influx_store *store = calloc(1, sizeof(*store));
+	if (store == NULL)
+	{
+		munmap(map, (size_t)blocks * INFLUX_STORE_BLOCK);
+		return NULL;
+	}
+	pthread_mutex_init(&store->lock, NULL);
+	store->map = map;
+	store->nblocks = blocks;
+	store->readonly = readonly;
+	store->head = -1;
+
+	// the newest block that decodes takes the next appends; the others (torn by a power loss) are cleared,
+	// and so are full ones that don't match their header or checksum
+	uint64_t newest = 0;
+	for (unsigned slot = 0; slot < blocks; slot++)
+	{
+		codec state;
+		if (block_decodes(store, slot, &state) && (store->head < 0 || block_at(store, slot)->sequence > newest))
+		{
+			store->head = (int)slot;
+			newest = block_at(store, slot)->sequence;
+		}
+	}
+	for (unsigned slot = 0; slot < blocks; slot++)
+	{
+		store_block *block = block_at(store, slot);
+		if ((int)slot != store->head && block->magic != 0 && !block_valid(store, slot))
+		{
+			fprintf(stderr, "*** influx store %s: %s a damaged block!\n", path, readonly ? "skipping" : "dropping");
+			block->magic = 0;
+		}
+	}
+
+	if (store->head >= 0)
+	{
+		rebuild_head(store);
+	}
+	return store;
+}
+
+influx_store *influx_store_open(const char *path, unsigned blocks)
+{
+	if (path == NULL || blocks < 2)
+	{
+		return NULL;
+	}
+	return open_store(path, blocks, 0);
+}
+
+influx_store *influx_store_open_readonly(const char *path)
+{
+	if (path == NULL)
+	{
+		return NULL;
+	}
+	return open_store(path, 0, 1);
+}
+
+// start a new block in the slot after the head with the first point
+static void start_block(influx_store *store, int64_t timestamp, double value)
+{
+	uint64_t sequence = 0;
+	unsigned slot = 0;
+	if (store->head >= 0)
+	{
+		store_block *full = block_at(store, (unsigned)store->head);
+		full->crc = influx_crc32(0, stream_of(full), (full->bits + 7) / 8);
+		sequence = full->sequence + 1;
+		slot = ((unsigned)store->head + 1) % store->nblocks;
+	}
+
+	store_block *block = block_at(store, slot);
+	block->magic = 0;
+	block->crc = 0;
+	memset(&store->state, 0, sizeof(store->state));
+	store->state.timestamp = timestamp;
+	store->state.value = double_bits(value);
+	store->state.leading = -1;
+	put_bits(stream_of(block), &store->state.position, store->state.value, 64);
+
+	block->count = 1;
+	block->sequence = sequence;
+	block->first = block->last = block->min_at = block->max_at = timestamp;
+	block->min = block->max = block->sum = value;
+	block->bits = store->state.position;
+	__atomic_store_n(&block->magic, STORE_MAGIC, __ATOMIC_RELEASE);
+	store->head = (int)slot;
+}
+
+influx_status influx_store_append(influx_store *store, long long timestamp, double value)
+{
+	if (store == NULL || store->readonly || value != value)
+	{
+		return INFLUX_INVALID;
+	}
+
+	pthread_mutex_lock(&store->lock);
+	store_block *block = store->head >= 0 ? block_at(store, (unsigned)store->head) : NULL;
+	if (block != NULL && timestamp < block->last)
+	{
+		pthread_mutex_unlock(&store->lock);
+		return INFLUX_INVALID;
+	}
+
+	// a point that might not fit, or whose timestamp can't be encoded, opens a new block
+	codec state = store->state;
+	if (block == NULL || state.position + MAX_POINT_BITS > STREAM_BITS || !encode(stream_of(block), &state, timestamp, double_bits(value)))
+	{
+		start_block(store, timestamp, value);
+		pthread_mutex_unlock(&store->lock);
+		return INFLUX_OK;
+	}
+
+	store->state = state;
+	if (value < block->min)
+	{
+		block->min = value;
+		block->min_at = timestamp;
+	}
+	if (value > block->max)
+	{
+		block->max = value;
+		block->max_at = timestamp;
+	}
+	block->sum += value;
+	block->last = timestamp;
+	block->bits = state.position;
+	__atomic_store_n(&block->count, block->count + 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&store->lock);
+	return INFLUX_OK;
+}
+
+// the i-th oldest block if it holds points in [from, to], with lock held
+static store_block *block_in(const influx_store *store, unsigned i, long long from, long long to)
+{
+	store_block *block = block_at(store, ((unsigned)store->head + 1 + i) % store->nblocks);
+	if (store->head < 0 || block->magic != STORE_MAGIC || block->count == 0 || block->last < from || block->first > to)
+	{
+		return NULL;
+	}
+	return block;
+}
+
+unsigned influx_store_scan(influx_store *store, long long from, long long to, long long *timestamps, double *values, unsigned max)
+{
+	if (store == NULL)
+	{
+		return 0;
+	}
+
+	unsigned n = 0;
+	pthread_mutex_lock(&store->lock);
+	for (unsigned b = 0; b < store->nblocks && n < max; b++)
+	{
+		store_block *block = block_in(store, b, from, to);
+		if (block == NULL)
+		{
+			continue;
+		}
+
+		codec state;
+		decode_first(block, &state);
+		for (uint32_t i = 0; i < block->count && n < max; i++)
+		{
+			if (i > 0)
+			{
+				decode(stream_of(block), &state);
+			}
+			if (state.timestamp > to)
+			{
+				break;
+			}
+			if (state.timestamp >= from)
+			{
+				timestamps[n] = state.timestamp;
+				values[n] = bits_double(state.value);
+				n++;
+			}
+		}
+	}
+	pthread_mutex_unlock(&store->lock);
+	return n;
+}
+
+// fold count points (first to last, with their min, max and sum) into summary
+static void merge(influx_store_summary *summary, unsigned long count, long long first, long long last, double min, long long min_at, double max, long long max_at, double sum)
+{
+	if (summary->count == 0 || min < summary->min)
+	{
+		summary->min = min;
+		summary->min_at = min_at;
+	}
+	if (summary->count == 0 || max > summary->max)
+	{
+		summary->max = max;
+		summary->max_at = max_at;
+	}
+	if (summary->count == 0)
+	{
+		summary->first = first;
+	}
+	summary->last = last;
+	summary->sum += sum;
+	summary->count += count;
+}
+
+void influx_store_summarize(influx_store *store, long long from, long long to, influx_store_summary *summary)
+{
+	memset(summary, 0, sizeof(*summary));
+	if (store == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&store->lock);
+	for (unsigned b = 0; b < store->nblocks; b++)
+	{
+		store_block *block = block_in(store, b, from, to);
+		if (block == NULL)
+		{
+			continue;
+		}
+
+		// blocks wholly inside the range answer from their header, only the ones at the edges are decoded
+		if (block->first >= from && block->last <= to)
+		{
+			merge(summary, block->count, block->first, block->last, block->min, block->min_at, block->max, block->max_at, block->sum);
+			continue;
+		}
+
+		codec state;
+		decode_first(block, &state);
+		for (uint32_t i = 0; i < block->count; i++)
+		{
+			if (i > 0)
+			{
+				decode(stream_of(block), &state);
+			}
+			if (state.timestamp > to)
+			{
+				break;
+			}
+			double value = bits_double(state.value);
+			if (state.timestamp >= from)
+			{
+				merge(summary, 1, state.timestamp, state.timestamp, value, state.timestamp, value, state.timestamp, value);
+			}
+		}
+	}
+	pthread_mutex_unlock(&store->lock);
+}
+
+void influx_store_sync(influx_store *store)
+{
+	if (store != NULL && !store->readonly)
+	{
+		msync(store->map, (size_t)store->nblocks * INFLUX_STORE_BLOCK, MS_SYNC);
+	}
+}
+
+void influx_store_close(influx_store *store)
+{
+	if (store == NULL)
+	{
+		return;
+	}
+
+	influx_store_sync(store);
+	munmap(store->map, (size_t)store->nblocks * INFLUX_STORE_BLOCK);
+	pthread_mutex_destroy(&store->lock);
+	free(store);
+}
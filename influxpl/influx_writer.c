@@ -0,0 +1,476 @@
+#include "./influx.h"
+#include <curl/curl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define RETRY_MAX_MS (5 * 60 * 1000) // failed attempts back off from flush_ms up to this
+
+struct influx_writer
+{
+	CURL *curl;
+	struct curl_slist *headers;
+	char *url;
+
+	pthread_mutex_t lock;
+	pthread_cond_t wake;    // flush thread, on CLOCK_MONOTONIC
+	pthread_cond_t flushed; // influx_writer_flush()
+	pthread_t thread;
+	int stop;
+	int force;
+
+	size_t batch_bytes;
+	unsigned flush_ms;
+
+	// producers fill active, the flush thread sends pending; both guarded by lock except while pending is in flight.
+	// With a spool, active is only where a point is encoded before it is appended, and pending is read from the spool
+	influx_spool *spool;
+	unsigned long evicted; // the spool's evicted count already accounted for
+	influx_buffer buffers[2];
+	influx_buffer *active;
+	influx_buffer *pending;
+	unsigned long long active_since; // CLOCK_MONOTONIC ms of the oldest point in active (or the spool)
+	unsigned long long retry_at;     // when pending is tried again after a failure, 0 if it isn't waiting
+	unsigned long long backoff_ms;   // wait before that, doubled by every failure in a row
+
+	unsigned long written; // points written to active, dropped ones included
+	unsigned long done;    // points sent or dropped for good
+	unsigned long attempts;
+	int last_failed;
+	influx_write_stats stats;
+};
+
+static unsigned long long monotonic_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static size_t discard(char *data, size_t size, size_t count, void *arg)
+{
+	(void)data;
+	(void)arg;
+	return size * count;
+}
+
+// POST a batch, returns the HTTP status or 0 if there was no answer
+static long post(influx_writer *writer, const influx_buffer *batch)
+{
+	curl_easy_setopt(writer->curl, CURLOPT_POSTFIELDS, batch->data);
+	curl_easy_setopt(writer->curl, CURLOPT_POSTFIELDSIZE, (long)batch->length);
+
+	CURLcode rc = curl_easy_perform(writer->curl);
+	if (rc != CURLE_OK)
+	{
+		fprintf(stderr, "*** influx write failed: %s!\n", curl_easy_strerror(rc));
+		return 0;
+	}
+
+	long status = 0;
+	curl_easy_getinfo(writer->curl, CURLINFO_RESPONSE_CODE, &status);
+	if (status / 100 != 2)
+	{
+		fprintf(stderr, "*** influx write failed (HTTP %ld)!\n", status);
+	}
+	return status;
+}
+
+// whether the server has taken the batch for good, one way or the other: a batch it rejected as malformed or too large
+// would only be rejected again, anything else (auth, a bucket not there yet, rate limits, 5xx) may go through later
+static int consumed_by(long status)
+{
+	return status / 100 == 2 || status == 400 || status == 413 || status == 422;
+}
+
+// whether the flush thread has something to do now, with lock held
+static int due(const influx_writer *writer, unsigned long long now)
+{
+	if (writer->pending->length > 0)
+	{
+		return writer->retry_at == 0 || now >= writer->retry_at || writer->force || writer->stop;
+	}
+	if (writer->spool != NULL)
+	{
+		// what is spooled is safe, stopping doesn't wait for it to be sent
+		size_t backlog = influx_spool_backlog(writer->spool);
+		return backlog > 0 && (writer->force || backlog >= writer->batch_bytes || now >= writer->active_since + writer->flush_ms);
+	}
+	if (writer->active->points == 0)
+	{
+		return 0;
+	}
+	return writer->force || writer->stop || writer->active->length >= writer->batch_bytes || now >= writer->active_since + writer->flush_ms;
+}
+
+// points waiting to be sent, with lock held
+static unsigned long backlog(const influx_writer *writer)
+{
+	if (writer->spool != NULL)
+	{
+		influx_spool_info info;
+		influx_spool_status(writer->spool, &info);
+		return info.backlog;
+	}
+	return writer->active->points + writer->pending->points;
+}
+
+static void *flush_main(void *arg)
+{
+	influx_writer *writer = arg;
+
+	pthread_mutex_lock(&writer->lock);
+	for (;;)
+	{
+		unsigned long long now = monotonic_ms();
+		if (!due(writer, now))
+		{
+			if (writer->stop)
+			{
+				break;
+			}
+
+			// sleep until the oldest point or the retry is due, or a producer fills the batch
+			unsigned long long until = 0;
+			if (writer->pending->length > 0)
+			{
+				until = writer->retry_at;
+			}
+			else if (writer->active->points > 0 || influx_spool_backlog(writer->spool) > 0)
+			{
+				until = writer->active_since + writer->flush_ms;
+			}
+			if (until == 0)
+			{
+				pthread_cond_wait(&writer->wake, &writer->lock);
+			}
+			else
+			{
+				struct timespec deadline = { (time_t)(until / 1000), (long)(until % 1000) * 1000000 };
+				pthread_cond_timedwait(&writer->wake, &writer->lock, &deadline);
+			}
+			continue;
+		}
+
+		if (writer->pending->length == 0 && writer->spool != NULL)
+		{
+			influx_spool_peek(writer->spool, writer->pending);
+		}
+		else if (writer->pending->length == 0)
+		{
+			influx_buffer *batch = writer->active;
+			writer->active = writer->pending;
+			writer->pending = batch;
+		}
+		writer->force = 0;
+		influx_spool *spool = writer->spool;
+		pthread_mutex_unlock(&writer->lock);
+
+		// nothing is sent before it is on disk, so the server can never have points the spool lost
+		influx_spool_sync(spool);
+		long status = post(writer, writer->pending);
+		int consumed = consumed_by(status);
+		if (consumed)
+		{
+			influx_spool_commit(spool);
+		}
+
+		pthread_mutex_lock(&writer->lock);
+		influx_buffer *batch = writer->pending;
+		writer->attempts++;
+		writer->stats.status = status;
+		if (writer->spool != NULL)
+		{
+			// points the spool's cap pushed out meanwhile are as done as they'll ever be
+			influx_spool_info info;
+			influx_spool_status(writer->spool, &info);
+			writer->stats.dropped += info.evicted - writer->evicted;
+			writer->done += info.evicted - writer->evicted;
+			writer->evicted = info.evicted;
+			writer->active_since = monotonic_ms();
+		}
+		if (consumed)
+		{
+			if (status / 100 == 2)
+			{
+				writer->stats.sent += batch->points;
+				writer->stats.batches++;
+				writer->stats.bytes += batch->length;
+			}
+			else
+			{
+				writer->stats.failures++;
+				writer->stats.dropped += batch->points;
+			}
+			writer->done += batch->points;
+			writer->retry_at = 0;
+			writer->backoff_ms = 0;
+			writer->last_failed = status / 100 != 2;
+			influx_buffer_reset(batch);
+		}
+		else
+		{
+			writer->stats.failures++;
+			writer->backoff_ms = writer->backoff_ms == 0 ? writer->flush_ms : writer->backoff_ms * 2 < RETRY_MAX_MS ? writer->backoff_ms * 2 : RETRY_MAX_MS;
+			writer->retry_at = monotonic_ms() + writer->backoff_ms;
+			writer->last_failed = 1;
+
+			// closing with the server down gets one last attempt, what can't be sent mustn't hold up the process;
+			// with a spool it stays there for the next run
+			if (writer->stop && writer->spool != NULL)
+			{
+				influx_buffer_reset(batch);
+				pthread_cond_broadcast(&writer->flushed);
+				break;
+			}
+			if (writer->stop)
+			{
+				writer->stats.dropped += batch->points + writer->active->points;
+				writer->done += batch->points + writer->active->points;
+				influx_buffer_reset(batch);
+				influx_buffer_reset(writer->active);
+			}
+		}
+		pthread_cond_broadcast(&writer->flushed);
+	}
+	pthread_mutex_unlock(&writer->lock);
+	return NULL;
+}
+
+influx_writer *influx_writer_open(const char *url, const char *org, const char *bucket, const char *token, size_t batch_bytes, unsigned flush_ms)
+{
+	static pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
+	static int global_done = 0;
+
+	if (url == NULL || org == NULL || bucket == NULL || batch_bytes == 0 || flush_ms == 0)
+	{
+		return NULL;
+	}
+
+	influx_writer *writer = calloc(1, sizeof(*writer));
+	if (writer == NULL)
+	{
+		return NULL;
+	}
+
+	// the curl_global_init() curl_easy_init() would do isn't thread-safe, so do it once up front
+	pthread_mutex_lock(&global_lock);
+	if (!global_done)
+	{
+		global_done = curl_global_init(CURL_GLOBAL_DEFAULT) == CURLE_OK;
+	}
+	pthread_mutex_unlock(&global_lock);
+
+	writer->curl = curl_easy_init();
+	if (writer->curl == NULL || influx_buffer_init(&writer->buffers[0], batch_bytes * 2) != INFLUX_OK || influx_buffer_init(&writer->buffers[1], batch_bytes * 2) != INFLUX_OK)
+	{
+		fprintf(stderr, "*** influx_writer_open failed: out of memory!\n");
+		influx_buffer_free(&writer->buffers[0]);
+		if (writer->curl != NULL)
+		{
+			curl_easy_cleanup(writer->curl);
+		}
+		free(writer);
+		return NULL;
+	}
+
+	char *org_escaped = curl_easy_escape(writer->curl, org, 0);
+	char *bucket_escaped = curl_easy_escape(writer->curl, bucket, 0);
+	size_t length = strlen(url) + strlen(org_escaped) + strlen(bucket_escaped) + 64;
+	writer->url = malloc(length);
+	snprintf(writer->url, length, "%s/api/v2/write?org=%s&bucket=%s&precision=ns", url, org_escaped, bucket_escaped);
+	curl_free(org_escaped);
+	curl_free(bucket_escaped);
+
+	if (token != NULL)
+	{
+		char authorization[512];
+		snprintf(authorization, sizeof(authorization), "Authorization: Token %s", token);
+		writer->headers = curl_slist_append(writer->headers, authorization);
+	}
+	writer->headers = curl_slist_append(writer->headers, "Content-Type: text/plain; charset=utf-8");
+
+	curl_easy_setopt(writer->curl, CURLOPT_URL, writer->url);
+	curl_easy_setopt(writer->curl, CURLOPT_HTTPHEADER, writer->headers);
+	curl_easy_setopt(writer->curl, CURLOPT_WRITEFUNCTION, discard);
+	curl_easy_setopt(writer->curl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(writer->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+	curl_easy_setopt(writer->curl, CURLOPT_CONNECTTIMEOUT_MS, 5000L);
+	curl_easy_setopt(writer->curl, CURLOPT_TIMEOUT_MS, 10000L);
+
+	writer->batch_bytes = batch_bytes;
+	writer->flush_ms = flush_ms;
+	writer->active = &writer->buffers[0];
+	writer->pending = &writer->buffers[1];
+
+	pthread_mutex_init(&writer->lock, NULL);
+	pthread_condattr_t monotonic;
+	pthread_condattr_init(&monotonic);
+	pthread_condattr_setclock(&monotonic, CLOCK_MONOTONIC);
+	pthread_cond_init(&writer->wake, &monotonic);
+	pthread_condattr_destroy(&monotonic);
+	pthread_cond_init(&writer->flushed, NULL);
+
+	if (pthread_create(&writer->thread, NULL, flush_main, writer) != 0)
+	{
+		fprintf(stderr, "*** influx_writer_open failed: could not create the flush thread!\n");
+		writer->thread = 0;
+		influx_writer_close(writer);
+		return NULL;
+	}
+
+	return writer;
+}
+
+influx_status influx_writer_point(influx_writer *writer, const influx_series *series, const char *const *keys, const double *values, unsigned integers, unsigned n, long long timestamp)
+{
+	if (writer == NULL)
+	{
+		return INFLUX_INVALID;
+	}
+
+	pthread_mutex_lock(&writer->lock);
+	if (writer->active->points == 0 && influx_spool_backlog(writer->spool) == 0)
+	{
+		writer->active_since = monotonic_ms();
+	}
+
+	influx_status rc = influx_point(writer->active, series, keys, values, integers, n, timestamp);
+	if (rc == INFLUX_OK && writer->spool != NULL)
+	{
+		size_t length = writer->active->length;
+		rc = influx_spool_append(writer->spool, writer->active->data, length);
+		influx_buffer_reset(writer->active);
+		if (rc != INFLUX_OK)
+		{
+			writer->stats.dropped++;
+		}
+		else
+		{
+			writer->written++;
+			writer->stats.points++;
+			size_t spooled = influx_spool_backlog(writer->spool);
+			if (spooled >= writer->batch_bytes || spooled == length)
+			{
+				pthread_cond_signal(&writer->wake);
+			}
+		}
+	}
+	else if (rc == INFLUX_OK)
+	{
+		writer->written++;
+		writer->stats.points++;
+		if (writer->active->length >= writer->batch_bytes || writer->active->points == 1)
+		{
+			pthread_cond_signal(&writer->wake);
+		}
+	}
+	else if (rc == INFLUX_FULL)
+	{
+		writer->stats.dropped++;
+	}
+	pthread_mutex_unlock(&writer->lock);
+
+	return rc;
+}
+
+influx_status influx_writer_flush(influx_writer *writer)
+{
+	if (writer == NULL)
+	{
+		return INFLUX_INVALID;
+	}
+
+	pthread_mutex_lock(&writer->lock);
+	unsigned long target = writer->written;
+	unsigned long attempts = writer->attempts;
+	writer->force = 1;
+	pthread_cond_signal(&writer->wake);
+
+	// until it is all out, or an attempt made after this call failed
+	while (writer->done < target && !(writer->attempts != attempts && writer->last_failed))
+	{
+		pthread_cond_wait(&writer->flushed, &writer->lock);
+	}
+	influx_status rc = writer->done >= target ? INFLUX_OK : INFLUX_UNREACHABLE;
+	pthread_mutex_unlock(&writer->lock);
+
+	return rc;
+}
+
+void influx_writer_stats(influx_writer *writer, influx_write_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	if (writer == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&writer->lock);
+	*stats = writer->stats;
+	stats->backlog = backlog(writer);
+	pthread_mutex_unlock(&writer->lock);
+}
+
+void influx_writer_close(influx_writer *writer)
+{
+	if (writer == NULL)
+	{
+		return;
+	}
+
+	if (writer->thread != 0)
+	{
+		pthread_mutex_lock(&writer->lock);
+		writer->stop = 1;
+		pthread_cond_signal(&writer->wake);
+		pthread_mutex_unlock(&writer->lock);
+		pthread_join(writer->thread, NULL);
+	}
+
+	pthread_cond_destroy(&writer->flushed);
+	pthread_cond_destroy(&writer->wake);
+	pthread_mutex_destroy(&writer->lock);
+	influx_spool_close(writer->spool);
+	curl_slist_free_all(writer->headers);
+	curl_easy_cleanup(writer->curl);
+	free(writer->url);
+	influx_buffer_free(&writer->buffers[0]);
+	influx_buffer_free(&writer->buffers[1]);
+	free(writer);
+}
+
+influx_status influx_writer_spool(influx_writer *writer, const char *directory, size_t segment_bytes, size_t max_bytes)
+{
+	if (writer == NULL)
+	{
+		return INFLUX_INVALID;
+	}
+
+	influx_spool *spool = influx_spool_open(directory, segment_bytes, max_bytes);
+	if (spool == NULL)
+	{
+		return INFLUX_INVALID;
+	}
+
+	pthread_mutex_lock(&writer->lock);
+	if (writer->spool != NULL || writer->written > 0)
+	{
+		pthread_mutex_unlock(&writer->lock);
+		influx_spool_close(spool);
+		return INFLUX_INVALID;
+	}
+
+	// a backlog from a previous run is sent right away
+	influx_spool_info info;
+	influx_spool_status(spool, &info);
+	writer->spool = spool;
+	writer->written += info.backlog;
+	writer->active_since = monotonic_ms() - writer->flush_ms;
+	pthread_cond_signal(&writer->wake);
+	pthread_mutex_unlock(&writer->lock);
+
+	return INFLUX_OK;
+}
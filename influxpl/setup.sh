@@ -0,0 +1,3 @@
+# compile and generate libinflux.so, the native InfluxDB ingestion code writeToDB.py uses through influx.py
+
+gcc -O2 -fPIC -shared -o libinflux.so influx_*.c -lm -lpthread -lcurl
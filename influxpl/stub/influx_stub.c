@@ -0,0 +1,249 @@
+/*
+   * Stand-in for an InfluxDB server, answering POST /api/v2/write over keep-alive HTTP/1.1 connections
+   * so influx_writer can be run and measured without a database, e.g.
+   *
+   *     INFLUX_STUB_LATENCY=20 INFLUX_STUB_STATUS=204,204,503 ./influx_stub -p 8086
+   *
+   * Every request is logged on stdout: connection, time since the stub started, status, bytes and points (lines).
+   *
+   * INFLUX_STUB_LATENCY  ms every answer is delayed by, defaults to 0
+   * INFLUX_STUB_STATUS   comma separated HTTP status sequence returned by successive writes,
+   *                      repeated when exhausted (e.g. "204,204,503"), defaults to always 204
+*/
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_CLIENTS 16
+#define MAX_STATUS 64
+#define REQUEST_MAX (4 * 1024 * 1024)
+
+typedef struct
+{
+	int fd;
+	unsigned id;
+	char *data;
+	size_t length;
+} client;
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int signal)
+{
+	(void)signal;
+	stop = 1;
+}
+
+static double now_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static const char *reason(int status)
+{
+	switch (status)
+	{
+	case 204:
+		return "No Content";
+	case 400:
+		return "Bad Request";
+	case 401:
+		return "Unauthorized";
+	case 429:
+		return "Too Many Requests";
+	case 503:
+		return "Service Unavailable";
+	default:
+		return status / 100 == 2 ? "OK" : "Error";
+	}
+}
+
+// answer every complete request in the client's buffer, returns 0 once the connection should be closed
+static int serve(client *c, const int *statuses, unsigned nstatuses, unsigned *next, unsigned latency, double started)
+{
+	for (;;)
+	{
+		char *end = memmem(c->data, c->length, "\r\n\r\n", 4);
+		if (end == NULL)
+		{
+			return c->length < REQUEST_MAX;
+		}
+		size_t header = (size_t)(end - c->data) + 4;
+
+		size_t content = 0;
+		for (char *line = c->data; line < end; line = strstr(line, "\r\n") + 2)
+		{
+			if (strncasecmp(line, "Content-Length:", 15) == 0)
+			{
+				content = strtoul(line + 15, NULL, 10);
+			}
+		}
+		if (header + content > REQUEST_MAX)
+		{
+			return 0;
+		}
+		if (c->length < header + content)
+		{
+			return 1;
+		}
+
+		unsigned points = 0;
+		for (size_t i = header; i < header + content; i++)
+		{
+			points += c->data[i] == '\n';
+		}
+
+		int status = 404;
+		if (strncmp(c->data, "POST /api/v2/write", 18) == 0)
+		{
+			status = nstatuses > 0 ? statuses[(*next)++ % nstatuses] : 204;
+		}
+		if (latency > 0)
+		{
+			usleep(latency * 1000);
+		}
+
+		char answer[128];
+		int n = snprintf(answer, sizeof(answer), "HTTP/1.1 %d %s\r\nContent-Length: 0\r\n\r\n", status, reason(status));
+		if (send(c->fd, answer, (size_t)n, MSG_NOSIGNAL) != n)
+		{
+			return 0;
+		}
+		printf("connection %u  %10.1f ms  %d  %zu bytes  %u points\n", c->id, now_ms() - started, status, content, points);
+		fflush(stdout);
+
+		c->length -= header + content;
+		memmove(c->data, c->data + header + content, c->length);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned port = 8086;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "p:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'p':
+			port = (unsigned)strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-p port]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	unsigned latency = getenv("INFLUX_STUB_LATENCY") ? (unsigned)strtoul(getenv("INFLUX_STUB_LATENCY"), NULL, 10) : 0;
+	int statuses[MAX_STATUS];
+	unsigned nstatuses = 0, next = 0;
+	for (const char *s = getenv("INFLUX_STUB_STATUS"); s != NULL && *s != '\0' && nstatuses < MAX_STATUS; s = strchr(s, ',') ? strchr(s, ',') + 1 : NULL)
+	{
+		statuses[nstatuses++] = atoi(s);
+	}
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = on_signal;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+	int on = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons((unsigned short)port);
+	if (listener < 0 || bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 16) != 0)
+	{
+		perror("*** influx_stub: bind");
+		return 1;
+	}
+
+	// pfds[0] is the listening socket, pfds[i] belongs to clients[i - 1]
+	struct pollfd pfds[1 + MAX_CLIENTS];
+	client clients[MAX_CLIENTS];
+	unsigned nclients = 0, connections = 0;
+	pfds[0].fd = listener;
+	pfds[0].events = POLLIN;
+	double started = now_ms();
+
+	while (!stop)
+	{
+		if (poll(pfds, 1 + nclients, -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			perror("*** influx_stub: poll");
+			break;
+		}
+
+		for (unsigned i = 1; i <= nclients; i++)
+		{
+			client *c = &clients[i - 1];
+			if (pfds[i].revents == 0)
+			{
+				continue;
+			}
+
+			char chunk[65536];
+			ssize_t n = recv(c->fd, chunk, sizeof(chunk), 0);
+			char *data = n > 0 ? realloc(c->data, c->length + (size_t)n) : NULL;
+			if (data != NULL)
+			{
+				c->data = data;
+				memcpy(c->data + c->length, chunk, (size_t)n);
+				c->length += (size_t)n;
+			}
+			if (data == NULL || !serve(c, statuses, nstatuses, &next, latency, started))
+			{
+				close(c->fd);
+				free(c->data);
+				*c = clients[nclients - 1];
+				pfds[i--] = pfds[nclients--];
+			}
+		}
+
+		if (pfds[0].revents & POLLIN)
+		{
+			int fd = accept(listener, NULL, NULL);
+			if (fd >= 0 && nclients == MAX_CLIENTS)
+			{
+				fprintf(stderr, "*** influx_stub: too many clients!\n");
+				close(fd);
+			}
+			else if (fd >= 0)
+			{
+				clients[nclients] = (client){ fd, ++connections, NULL, 0 };
+				nclients++;
+				pfds[nclients].fd = fd;
+				pfds[nclients].events = POLLIN;
+				pfds[nclients].revents = 0;
+			}
+		}
+	}
+
+	for (unsigned i = 0; i < nclients; i++)
+	{
+		close(clients[i].fd);
+		free(clients[i].data);
+	}
+	close(listener);
+	printf("%u connections\n", connections);
+	return 0;
+}
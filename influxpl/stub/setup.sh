@@ -0,0 +1,6 @@
+# build influx_stub, a stand-in InfluxDB server, so the batched writer can be run without a database
+# its latency and answers are scripted through INFLUX_STUB_* environment variables (see influx_stub.c)
+
+cd "$(dirname "$0")"
+
+gcc -O2 -D_GNU_SOURCE -o influx_stub influx_stub.c
@@ -0,0 +1,76 @@
+# ctypes bindings for the shared library generated by geigerpl/geiger_*.c
+
+import ctypes
+
+BATCH = 64
+DOSE_WINDOWS = 4
+
+
+class CaptureInfo(ctypes.Structure):
+    # mirrors geiger_capture_info in geigerpl/geiger.h
+    _fields_ = [
+        ("pulses", ctypes.c_ulonglong),
+        ("read", ctypes.c_ulonglong),
+        ("lost", ctypes.c_ulonglong),
+        ("overrun", ctypes.c_ulonglong),
+        ("batches", ctypes.c_ulonglong),
+        ("backlog", ctypes.c_uint),
+    ]
+
+
+class ActuatorInfo(ctypes.Structure):
+    # mirrors geiger_actuator_info in geigerpl/geiger.h
+    _fields_ = [
+        ("requested", ctypes.c_ulong),
+        ("strokes", ctypes.c_ulong),
+        ("coalesced", ctypes.c_ulong),
+        ("failures", ctypes.c_ulong),
+        ("pending", ctypes.c_ulong),
+    ]
+
+
+class Dose(ctypes.Structure):
+    # mirrors geiger_dose in geigerpl/geiger.h, windows of 10 s, 60 s, 10 min and 1 h
+    _fields_ = [
+        ("counts", ctypes.c_ulonglong * DOSE_WINDOWS),
+        ("minutes", ctypes.c_double * DOSE_WINDOWS),
+        ("cpm", ctypes.c_double * DOSE_WINDOWS),
+        ("corrected_cpm", ctypes.c_double * DOSE_WINDOWS),
+        ("usvh", ctypes.c_double * DOSE_WINDOWS),
+        ("error", ctypes.c_double * DOSE_WINDOWS),
+        ("saturated", ctypes.c_uint),
+    ]
+
+
+lib = ctypes.CDLL("geigerpl/libgeiger.so")
+
+lib.geiger_capture_open.restype = ctypes.c_void_p
+lib.geiger_capture_open.argtypes = [ctypes.c_char_p, ctypes.c_uint, ctypes.c_uint, ctypes.c_uint]
+lib.geiger_capture_attach.restype = ctypes.c_void_p
+lib.geiger_capture_attach.argtypes = [ctypes.c_int, ctypes.c_uint]
+lib.geiger_capture_read.restype = ctypes.c_uint
+lib.geiger_capture_read.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint64), ctypes.c_uint]
+lib.geiger_capture_status.argtypes = [ctypes.c_void_p, ctypes.POINTER(CaptureInfo)]
+lib.geiger_capture_close.argtypes = [ctypes.c_void_p]
+lib.geiger_capture_count.argtypes = [ctypes.c_void_p, ctypes.c_void_p]
+
+lib.geiger_counter_open.restype = ctypes.c_void_p
+lib.geiger_counter_open.argtypes = [ctypes.c_uint, ctypes.c_uint]
+lib.geiger_counter_pulses.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint64), ctypes.c_uint]
+lib.geiger_counter_count.restype = ctypes.c_ulonglong
+lib.geiger_counter_count.argtypes = [ctypes.c_void_p, ctypes.c_uint64, ctypes.c_uint]
+lib.geiger_counter_cpm.restype = ctypes.c_double
+lib.geiger_counter_cpm.argtypes = [ctypes.c_void_p, ctypes.c_uint64, ctypes.c_uint]
+lib.geiger_counter_total.restype = ctypes.c_ulonglong
+lib.geiger_counter_total.argtypes = [ctypes.c_void_p]
+lib.geiger_counter_close.argtypes = [ctypes.c_void_p]
+
+lib.geiger_actuator_open.restype = ctypes.c_void_p
+lib.geiger_actuator_open.argtypes = [ctypes.c_char_p, ctypes.c_uint, ctypes.c_uint, ctypes.c_uint, ctypes.c_uint]
+lib.geiger_actuator_advance.argtypes = [ctypes.c_void_p, ctypes.c_uint]
+lib.geiger_actuator_status.argtypes = [ctypes.c_void_p, ctypes.POINTER(ActuatorInfo)]
+lib.geiger_actuator_close.argtypes = [ctypes.c_void_p]
+
+lib.geiger_tube_find.restype = ctypes.c_void_p
+lib.geiger_tube_find.argtypes = [ctypes.c_char_p]
+lib.geiger_dose_rates.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_uint64, ctypes.POINTER(Dose)]
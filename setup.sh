@@ -3,7 +3,7 @@
 # install the necessary packages on ubuntu/debian
 sudo apt-get update
 sudo apt-get upgrade
-sudo apt-get install python3-pip python3-dev python3-rpi.gpio build-essential python3-numpy
+sudo apt-get install python3-pip python3-dev python3-rpi.gpio build-essential
 
 # install the Adafruit Python DHT module to work with the DHT11/DHT22 sensors
 cd ~
@@ -13,7 +13,6 @@ sudo python3 raspi-blinka.py
 pip3 install adafruit-circuitpython-dht
 sudo apt-get install libgpiod2
 
-# install the influxdb client for communicating (querying and writing data)
-# with the InfluxDB instance hosted on a remote server
-# install numpy for interacting with C functions using ctype
-pip3 install influxdb-client
+# install libcurl's headers, which influxpl/setup.sh needs to build the batched writer that sends
+# the readings to the InfluxDB instance hosted on a remote server
+sudo apt-get install libcurl4-openssl-dev
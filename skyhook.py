@@ -1,24 +1,94 @@
-import ctypes
-import time
-from numpy.ctypeslib import ndpointer
-from writeToDB import write
+import math
+import os
+import select
+import constants as C
+from getloc import Fix, FenceEvent, TrackEstimate, lib as getloc
+from writeToDB import write_fields
+from alert import telegram_bot_sendtext
 
-while True:
+# maximum time in milliseconds between location reports from the WPS API
+PERIOD_MS = 300 * 1000
 
-    # use the shared library generated by skyhookpl/getlocation.c
-    getloc = ctypes.CDLL("skyhookpl/libgetloc.so")
+# offline tokens captured while the Skyhook server is unreachable are kept here,
+# and resolved into fixes once it is reachable again (checked at least every SPOOL_INTERVAL_S)
+SPOOL_PATH = b"skyhookpl/offline.spool"
+SPOOL_INTERVAL_S = 600
 
-    # use the ndpointer function provided by numpy, and pass the expected array datatype and the expected size of the same array
-    # use this to set the value of restype, which will help identify the datatype of the return value of the C function
-    getloc.getLocation.restype = ndpointer(dtype=ctypes.c_double, shape=(2,))
+# tiles let most fixes be computed locally, 3x3 tiles around the unit are fetched at startup
+TILE_DIR = "skyhookpl/tiles/"
+TILE_MAX_PER_SESSION = 450 * 1024
+TILE_MAX_TOTAL = 2 * 1024 * 1024
+TILE_PREFETCH = 9
 
-    # store the coordinates array of type double returned by the function defined by getlocation.c as a list in result
-    # and return it to the calling function
-    result = getloc.getLocation()
-    write("Latitude", result[0])
-    write("Longitude", result[1])
+# the unit's assigned site, we only hear about it when the unit leaves or re-enters it
+SITE_RADIUS_M = 200
+SITE_PERIOD_MS = 60 * 1000
 
-    # print the values if you need to
-    print(f"Latitude : {result[0]}, Longitude : {result[1]}")
-    time.sleep(300)
+# fixes with a larger horizontal positioning error than this are too vague to be worth writing
+MAX_HPE_M = 500
 
+# open a session once, this loads the WPS API and sets the key for the lifetime of the script
+session = getloc.getloc_open(None)
+if not session:
+    raise RuntimeError("could not open a WPS session")
+
+# every fix is also published to shared memory, where writeToDB.py picks it up to geotag the other sensors' readings
+if getloc.getloc_publish(session, None) != 0:
+    print("could not publish the latest fix, readings will only be geotagged if getlocd publishes it")
+
+os.makedirs(TILE_DIR, exist_ok=True)
+if getloc.getloc_tiles_open(session, TILE_DIR.encode(), TILE_MAX_PER_SESSION, TILE_MAX_TOTAL, TILE_PREFETCH) != 0:
+    print("could not set up the tile cache, every fix will go to the server")
+
+# the key encrypts the spooled tokens, keep it in constants.py so the spool survives restarts
+spool_key = C.skyhook_spool_key.encode()
+if getloc.getloc_spool_open(session, SPOOL_PATH, spool_key, len(spool_key), SPOOL_INTERVAL_S) != 0:
+    print("could not open the offline spool, fixes will be lost while the server is unreachable")
+
+# geofences are evaluated by the location stream, and each transition makes fence_fd readable
+if getloc.getloc_fence_add(session, C.site_latitude, C.site_longitude, SITE_RADIUS_M, SITE_PERIOD_MS) < 0:
+    print("could not register the site geofence")
+fence_fd = getloc.getloc_fence_fd(session)
+events = (FenceEvent * 8)()
+
+# fixes arrive on a background thread at the WPS API's own cadence,
+# we only drain whatever has accumulated, so this loop never blocks on a Wi-Fi scan
+if getloc.getloc_stream_start(session, PERIOD_MS) != 0:
+    raise RuntimeError("could not start the location stream")
+
+fixes = (Fix * 16)()
+
+# every fix feeds libgetloc's Kalman filter, we write the smoothed track rather than the raw fixes
+track = TrackEstimate()
+written = 0
+
+try:
+    while True:
+        getloc.getloc_stream_drain(session, fixes, len(fixes))
+
+        # only write when a fix was accepted since the last write, outliers and quiet periods add nothing
+        if getloc.getloc_track_get(session, track) and track.accepted != written:
+            written = track.accepted
+            hpe = math.sqrt((track.covariance[0] + track.covariance[2]) / 2)
+            if hpe <= MAX_HPE_M:
+                write_fields({"Latitude": track.latitude, "Longitude": track.longitude, "HPE": hpe}, track.observed * 1000000, live=False)
+
+                # print the values if you need to
+                print(f"Latitude : {track.latitude}, Longitude : {track.longitude}")
+
+        # fixes resolved from the spool are written at the time they were observed
+        n = getloc.getloc_spool_drain(session, fixes, len(fixes))
+        for fix in fixes[:n]:
+            write_fields({"Latitude": fix.latitude, "Longitude": fix.longitude}, fix.observed * 1000000, live=False)
+
+        # sleep until the next transition (or the next time we want to drain fixes)
+        readable, _, _ = select.select([fence_fd] if fence_fd >= 0 else [], [], [], 1)
+        if readable:
+            n = getloc.getloc_fence_drain(session, events, len(events))
+            for event in events[:n]:
+                state = "ENTERED" if event.entered else "LEFT"
+                message = f"ALERT! UNIT HAS {state} ITS SITE! LAST POSITION : {event.fix.latitude}, {event.fix.longitude}"
+                telegram_bot_sendtext(message)
+finally:
+    getloc.getloc_stream_stop(session)
+    getloc.getloc_close(session)
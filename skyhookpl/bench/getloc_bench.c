@@ -0,0 +1,286 @@
+/*
+   * Latency and throughput of the libgetloc entry points, meant to be run against the WPS stub
+   * (see setup.sh) with the stub's latency and error scripts set in the environment, e.g.
+   *
+   *     WPS_STUB_LATENCY=lognormal:2:0.5 WPS_STUB_ERRORS=0,0,0,5 ./getloc_bench -n 2000
+   *
+   * Every benchmark reports p50/p99/p999 per call in microseconds and calls per second,
+   * followed by the per WPS call statistics libgetloc recorded along the way.
+   *
+   * The circuit breakers are off unless -b is given, so an error script measures the WPS calls failing rather
+   * than the breakers failing them fast. With -b they keep their defaults, and every benchmark gets a session of
+   * its own so breakers one of them tripped don't carry over into the next. getLocation() opens its own session,
+   * which always has them.
+*/
+#include "../getlocation.h"
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_us()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, unsigned n, double p)
+{
+	unsigned i = (unsigned)(p * (n - 1) + 0.5);
+	return sorted[i < n ? i : n - 1];
+}
+
+static void report(const char *name, double *samples, unsigned n, unsigned failures, double elapsed_us)
+{
+	if (n == 0)
+	{
+		printf("%-16s no samples\n", name);
+		return;
+	}
+	qsort(samples, n, sizeof(double), compare);
+	printf("%-16s n=%-7u fail=%-5u p50=%10.1fus p99=%10.1fus p999=%10.1fus %10.0f/s\n", name, n, failures, percentile(samples, n, 0.5), percentile(samples, n, 0.99), percentile(samples, n, 0.999), n / (elapsed_us / 1e6));
+}
+
+// what getLocation() used to do on every call
+static void bench_reload(double *samples, unsigned n)
+{
+	unsigned failures = 0;
+	double start = now_us();
+	for (unsigned i = 0; i < n; i++)
+	{
+		double t = now_us();
+		WPS_load();
+		WPS_set_key(GETLOC_KEY);
+		WPS_Location *location;
+		if (WPS_location(NULL, WPS_NO_STREET_ADDRESS_LOOKUP, &location) == WPS_OK)
+		{
+			WPS_free_location(location);
+		}
+		else
+		{
+			failures++;
+		}
+		WPS_unload();
+		samples[i] = now_us() - t;
+	}
+	report("reload-per-call", samples, n, failures, now_us() - start);
+}
+
+static void bench_locate(getloc_session *session, double *samples, unsigned n)
+{
+	unsigned failures = 0;
+	getloc_fix fix;
+	double start = now_us();
+	for (unsigned i = 0; i < n; i++)
+	{
+		double t = now_us();
+		failures += getloc_locate(session, &fix) != WPS_OK;
+		samples[i] = now_us() - t;
+	}
+	report("getloc_locate", samples, n, failures, now_us() - start);
+}
+
+// submit and wait on the eventfd, i.e. the full round trip an event loop sees
+static void bench_async(getloc_session *session, double *samples, unsigned n)
+{
+	unsigned failures = 0;
+	getloc_async_result result;
+	double start = now_us();
+	for (unsigned i = 0; i < n; i++)
+	{
+		double t = now_us();
+		if (getloc_async_submit(session, NULL, NULL) == 0)
+		{
+			failures++;
+			continue;
+		}
+		struct pollfd pfd = { getloc_async_fd(session), POLLIN, 0 };
+		while (getloc_async_drain(session, &result, 1) == 0)
+		{
+			poll(&pfd, 1, -1);
+		}
+		failures += result.rc != WPS_OK;
+		samples[i] = now_us() - t;
+	}
+	report("getloc_async", samples, n, failures, now_us() - start);
+}
+
+static void bench_resolve(getloc_session *session, double *samples, unsigned n, unsigned long deadline)
+{
+	unsigned failures = 0;
+	unsigned tiers[4] = { 0, 0, 0, 0 };
+	getloc_fix fix;
+	double start = now_us();
+	for (unsigned i = 0; i < n; i++)
+	{
+		double t = now_us();
+		if (getloc_resolve(session, deadline, &fix) == WPS_OK)
+		{
+			tiers[fix.source & 3]++;
+		}
+		else
+		{
+			failures++;
+		}
+		samples[i] = now_us() - t;
+	}
+	report("getloc_resolve", samples, n, failures, now_us() - start);
+	printf("%-16s wifi=%u offline=%u ip=%u last-known=%u\n", "", tiers[GETLOC_SOURCE_WIFI], tiers[GETLOC_SOURCE_OFFLINE], tiers[GETLOC_SOURCE_IP], tiers[GETLOC_SOURCE_LAST_KNOWN]);
+}
+
+// drain latency, and how many fixes per second come through the ring
+static void bench_stream(getloc_session *session, double *samples, unsigned n, unsigned long period)
+{
+	getloc_fix fixes[GETLOC_STREAM_CAPACITY];
+	unsigned long received = 0;
+
+	getloc_stream_start(session, period);
+	double start = now_us();
+	for (unsigned i = 0; i < n; i++)
+	{
+		double t = now_us();
+		received += getloc_stream_drain(session, fixes, GETLOC_STREAM_CAPACITY);
+		samples[i] = now_us() - t;
+		usleep(1000);
+	}
+	double elapsed = now_us() - start;
+	getloc_stream_stop(session);
+
+	report("stream_drain", samples, n, 0, elapsed);
+	printf("%-16s fixes=%lu dropped=%lu %.0f fixes/s\n", "", received, getloc_stream_dropped(session), received / (elapsed / 1e6));
+}
+
+static getloc_session *bench_session(int breakers)
+{
+	getloc_session *session = getloc_open(NULL);
+	if (session == NULL)
+	{
+		exit(1);
+	}
+	for (int cls = 0; !breakers && cls < GETLOC_CLASSES; cls++)
+	{
+		getloc_breaker_config(session, cls, UINT_MAX, 1, 1);
+	}
+	return session;
+}
+
+// close the session a benchmark ran on, reporting the calls its breakers failed fast
+static void bench_done(getloc_session *session, int breakers)
+{
+	if (breakers)
+	{
+		getloc_breaker_info info[GETLOC_CLASSES];
+		for (int cls = 0; cls < GETLOC_CLASSES; cls++)
+		{
+			getloc_breaker_status(session, cls, &info[cls]);
+		}
+		printf("%-16s rejected by breakers: transient=%lu environment=%lu fatal=%lu\n", "", info[GETLOC_CLASS_TRANSIENT].rejected, info[GETLOC_CLASS_ENVIRONMENT].rejected, info[GETLOC_CLASS_FATAL].rejected);
+	}
+	getloc_close(session);
+}
+
+// what the SDK itself spent, as recorded by libgetloc, across every benchmark above
+static void report_sdk()
+{
+	getloc_call_stats stats;
+	for (int call = 0; call < GETLOC_CALLS; call++)
+	{
+		getloc_stats_snapshot(call, &stats);
+		if (stats.count == 0)
+		{
+			continue;
+		}
+		printf("%-22s n=%-7llu ok=%-7llu p50=%10.1fus p99=%10.1fus max=%10.1fus\n", getloc_call_name(call), stats.count, stats.codes[getloc_stats_code_index(WPS_OK)], getloc_stats_quantile(&stats, 0.5) / 1e3, getloc_stats_quantile(&stats, 0.99) / 1e3, stats.max / 1e3);
+	}
+}
+
+static void bench_legacy(double *samples, unsigned n)
+{
+	unsigned failures = 0;
+	double start = now_us();
+	for (unsigned i = 0; i < n; i++)
+	{
+		double t = now_us();
+		failures += getLocation() == NULL;
+		samples[i] = now_us() - t;
+	}
+	report("getLocation", samples, n, failures, now_us() - start);
+	printf("%-16s on a session of its own, breakers always on\n", "");
+}
+
+int main(int argc, char **argv)
+{
+	unsigned n = 1000;
+	unsigned long deadline = 50;
+	unsigned long period = 1;
+	int breakers = 0;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "n:d:p:b")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n':
+			n = (unsigned)atoi(optarg);
+			break;
+		case 'd':
+			deadline = strtoul(optarg, NULL, 10);
+			break;
+		case 'p':
+			period = strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			breakers = 1;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n iterations] [-d resolve deadline ms] [-p stream period ms] [-b]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	double *samples = malloc(n * sizeof(double));
+	if (samples == NULL || n == 0)
+	{
+		return 1;
+	}
+
+	// the per-call failures are expected when an error script is set, keep the output readable
+	if (freopen("/dev/null", "w", stderr) == NULL)
+	{
+		return 1;
+	}
+
+	printf("breakers %s\n\n", breakers ? "on, with their defaults, reset before every benchmark" : "off, every call reaches the WPS API (-b for on)");
+	bench_reload(samples, n);
+
+	getloc_session *session = bench_session(breakers);
+	bench_locate(session, samples, n);
+	bench_done(session, breakers);
+	session = bench_session(breakers);
+	bench_async(session, samples, n);
+	bench_done(session, breakers);
+	session = bench_session(breakers);
+	bench_resolve(session, samples, n, deadline);
+	bench_done(session, breakers);
+	session = bench_session(breakers);
+	bench_stream(session, samples, n, period);
+	bench_done(session, breakers);
+
+	bench_legacy(samples, n);
+
+	printf("\n");
+	report_sdk();
+
+	free(samples);
+	return 0;
+}
@@ -0,0 +1,13 @@
+# build getloc_bench against the stand-in libwpsapi.so from ../stub
+# libgetloc.so is built here too, so the one in skyhookpl (linked against Skyhook's library) is left alone
+#
+# run it with e.g.
+#   WPS_STUB_LATENCY=lognormal:2:0.5 WPS_STUB_ERRORS=0,0,0,5 ./getloc_bench -n 2000
+
+cd "$(dirname "$0")"
+
+sh ../stub/setup.sh
+
+gcc -O2 -fPIC -shared -o libgetloc.so ../getlocation.c ../getloc_*.c -lm -lpthread -lrt -L../stub -lwpsapi -Wl,-rpath,'$ORIGIN/../stub'
+gcc -O2 -o getloc_bench getloc_bench.c -L. -lgetloc -L../stub -lwpsapi -Wl,-rpath,'$ORIGIN:$ORIGIN/../stub'
+gcc -O2 -o getlocd ../getlocd.c -L. -lgetloc -L../stub -lwpsapi -Wl,-rpath,'$ORIGIN:$ORIGIN/../stub'
@@ -0,0 +1,191 @@
+#include "./getloc_internal.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define ASYNC_MASK (GETLOC_ASYNC_QUEUE - 1)
+
+_Static_assert((GETLOC_ASYNC_QUEUE & ASYNC_MASK) == 0, "GETLOC_ASYNC_QUEUE must be a power of two");
+
+// hand a result back to the submitter, called on the worker thread
+static void complete(getloc_session *session, const struct getloc_async_request *request, const getloc_async_result *result)
+{
+	if (request->callback != NULL)
+	{
+		request->callback(request->arg, result);
+		return;
+	}
+
+	unsigned long head = atomic_load_explicit(&session->async_head, memory_order_relaxed);
+	unsigned long tail = atomic_load_explicit(&session->async_tail, memory_order_acquire);
+	if (head - tail == GETLOC_ASYNC_QUEUE)
+	{
+		fprintf(stderr, "*** getloc async result %lu dropped, results are not being drained!\n", result->id);
+		return;
+	}
+
+	session->async_results[head & ASYNC_MASK] = *result;
+	atomic_store_explicit(&session->async_head, head + 1, memory_order_release);
+
+	uint64_t one = 1;
+	if (write(session->async_fd, &one, sizeof(one)) < 0)
+	{
+		perror("*** getloc async eventfd");
+	}
+}
+
+static void *async_main(void *arg)
+{
+	getloc_session *session = arg;
+
+	pthread_mutex_lock(&session->async_lock);
+	for (;;)
+	{
+		while (!session->async_stop && session->async_started == session->async_submitted)
+		{
+			pthread_cond_wait(&session->async_wake, &session->async_lock);
+		}
+		if (session->async_stop)
+		{
+			break;
+		}
+
+		struct getloc_async_request request = session->async_requests[session->async_started & ASYNC_MASK];
+		session->async_started++;
+		pthread_mutex_unlock(&session->async_lock);
+
+		// the scan runs without async_lock held, so submitting never waits for it
+		getloc_async_result result;
+		result.id = request.id;
+		result.rc = request.ip ? getloc_ip_locate(session, &result.fix) : getloc_locate(session, &result.fix);
+		complete(session, &request, &result);
+
+		pthread_mutex_lock(&session->async_lock);
+	}
+	pthread_mutex_unlock(&session->async_lock);
+	return NULL;
+}
+
+unsigned long getloc_async_submit(getloc_session *session, getloc_async_callback callback, void *arg)
+{
+	return getloc_async_submit_kind(session, 0, callback, arg);
+}
+
+unsigned long getloc_async_submit_kind(getloc_session *session, int ip, getloc_async_callback callback, void *arg)
+{
+	if (session == NULL || !session->loaded)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&session->async_lock);
+
+	// the worker and its eventfd are only set up once something is actually submitted
+	if (!session->async_running)
+	{
+		session->async_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (session->async_fd < 0)
+		{
+			perror("*** getloc_async_submit failed: eventfd");
+			pthread_mutex_unlock(&session->async_lock);
+			return 0;
+		}
+
+		session->async_stop = 0;
+		if (pthread_create(&session->async_thread, NULL, async_main, session) != 0)
+		{
+			fprintf(stderr, "*** getloc_async_submit failed: could not create the worker thread!\n");
+			close(session->async_fd);
+			session->async_fd = -1;
+			pthread_mutex_unlock(&session->async_lock);
+			return 0;
+		}
+		session->async_running = 1;
+	}
+
+	unsigned long id = 0;
+	if (session->async_submitted - session->async_started < GETLOC_ASYNC_QUEUE)
+	{
+		id = ++session->async_next_id;
+
+		struct getloc_async_request *request = &session->async_requests[session->async_submitted & ASYNC_MASK];
+		request->id = id;
+		request->ip = ip;
+		request->callback = callback;
+		request->arg = arg;
+		session->async_submitted++;
+		pthread_cond_signal(&session->async_wake);
+	}
+	pthread_mutex_unlock(&session->async_lock);
+
+	return id;
+}
+
+int getloc_async_fd(getloc_session *session)
+{
+	if (session == NULL)
+	{
+		return -1;
+	}
+
+	pthread_mutex_lock(&session->async_lock);
+	int fd = session->async_fd;
+	pthread_mutex_unlock(&session->async_lock);
+	return fd;
+}
+
+unsigned getloc_async_drain(getloc_session *session, getloc_async_result *results, unsigned max)
+{
+	if (session == NULL || getloc_async_fd(session) < 0)
+	{
+		return 0;
+	}
+
+	// reset the eventfd before popping, so a result queued meanwhile leaves it readable
+	uint64_t count;
+	if (read(session->async_fd, &count, sizeof(count)) < 0)
+	{
+		count = 0;
+	}
+
+	unsigned long tail = atomic_load_explicit(&session->async_tail, memory_order_relaxed);
+	unsigned long head = atomic_load_explicit(&session->async_head, memory_order_acquire);
+
+	unsigned n = 0;
+	while (tail != head && n < max)
+	{
+		results[n++] = session->async_results[tail & ASYNC_MASK];
+		tail++;
+	}
+	atomic_store_explicit(&session->async_tail, tail, memory_order_release);
+
+	// whatever didn't fit stays queued, keep the eventfd readable for it
+	if (tail != head)
+	{
+		uint64_t one = 1;
+		if (write(session->async_fd, &one, sizeof(one)) < 0)
+		{
+			perror("*** getloc async eventfd");
+		}
+	}
+
+	return n;
+}
+
+void getloc_async_close(getloc_session *session)
+{
+	pthread_mutex_lock(&session->async_lock);
+	int running = session->async_running;
+	session->async_stop = 1;
+	pthread_cond_signal(&session->async_wake);
+	pthread_mutex_unlock(&session->async_lock);
+
+	if (running)
+	{
+		pthread_join(session->async_thread, NULL);
+		session->async_running = 0;
+		close(session->async_fd);
+		session->async_fd = -1;
+	}
+}
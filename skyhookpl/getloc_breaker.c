@@ -0,0 +1,211 @@
+#include "./getloc_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *class_names[GETLOC_CLASSES] = { "transient", "environment", "fatal" };
+
+static unsigned long long monotonic_ms()
+{
+	return getloc_stats_begin() / 1000000;
+}
+
+getloc_class getloc_classify(WPS_ReturnCode rc)
+{
+	switch (rc)
+	{
+	case WPS_ERROR_TIMEOUT:
+	case WPS_ERROR_SERVER_UNAVAILABLE:
+		return GETLOC_CLASS_TRANSIENT;
+	case WPS_ERROR_NO_WIFI_IN_RANGE:
+	case WPS_ERROR_WIFI_NOT_AVAILABLE:
+	case WPS_ERROR_LOCATION_CANNOT_BE_DETERMINED:
+		return GETLOC_CLASS_ENVIRONMENT;
+	case WPS_ERROR_UNAUTHORIZED:
+	case WPS_ERROR_PROXY_UNAUTHORIZED:
+	case WPS_ERROR_LOCATION_SETTING_DISABLED:
+	case WPS_ERROR_LOCATION_NOT_PERMITTED:
+		return GETLOC_CLASS_FATAL;
+	default:
+		return GETLOC_CLASS_NONE;
+	}
+}
+
+void getloc_breaker_init(getloc_session *session)
+{
+	static const struct
+	{
+		unsigned threshold;
+		unsigned long base;
+		unsigned long max;
+	} defaults[GETLOC_CLASSES] = {
+		{ 3, 2 * 1000, 5 * 60 * 1000 },
+		{ 3, 10 * 1000, 10 * 60 * 1000 },
+		{ 1, 10 * 60 * 1000, 6 * 60 * 60 * 1000 },
+	};
+
+	pthread_mutex_init(&session->breaker_lock, NULL);
+	for (int i = 0; i < GETLOC_CLASSES; i++)
+	{
+		session->breakers[i].state = GETLOC_BREAKER_CLOSED;
+		session->breakers[i].threshold = defaults[i].threshold;
+		session->breakers[i].base = defaults[i].base;
+		session->breakers[i].max = defaults[i].max;
+		session->breakers[i].last = WPS_OK;
+	}
+	session->breaker_seed = (unsigned)getloc_stats_begin();
+}
+
+// open the breaker for base * 2^opens, capped at max, jittered over the upper half; breaker_lock held
+static void trip(getloc_session *session, getloc_class cls)
+{
+	struct getloc_breaker *breaker = &session->breakers[cls];
+
+	unsigned long backoff = breaker->base;
+	for (unsigned i = 0; i < breaker->opens && backoff < breaker->max; i++)
+	{
+		backoff *= 2;
+	}
+	if (backoff > breaker->max)
+	{
+		backoff = breaker->max;
+	}
+	backoff = backoff / 2 + (unsigned long)rand_r(&session->breaker_seed) % (backoff / 2 + 1);
+
+	breaker->state = GETLOC_BREAKER_OPEN;
+	breaker->probing = 0;
+	breaker->opens++;
+	breaker->open_until = monotonic_ms() + backoff;
+	fprintf(stderr, "*** getloc %s breaker open for %lu ms after %d!\n", class_names[cls], backoff, breaker->last);
+}
+
+unsigned getloc_breaker_allow(getloc_session *session, int ip, WPS_ReturnCode *rc)
+{
+	unsigned long long now = monotonic_ms();
+	unsigned probes = GETLOC_BREAKER_ALLOWED;
+
+	pthread_mutex_lock(&session->breaker_lock);
+	for (int i = 0; i < GETLOC_CLASSES; i++)
+	{
+		struct getloc_breaker *breaker = &session->breakers[i];
+		if (ip && i == GETLOC_CLASS_ENVIRONMENT)
+		{
+			continue;
+		}
+
+		if (breaker->state == GETLOC_BREAKER_OPEN && now >= breaker->open_until)
+		{
+			breaker->state = GETLOC_BREAKER_HALF_OPEN;
+		}
+
+		// one probe at a time, everyone else keeps failing fast until it reports back
+		if (breaker->state == GETLOC_BREAKER_OPEN || (breaker->state == GETLOC_BREAKER_HALF_OPEN && breaker->probing))
+		{
+			breaker->rejected++;
+			*rc = breaker->last;
+			probes = 0;
+			break;
+		}
+		if (breaker->state == GETLOC_BREAKER_HALF_OPEN)
+		{
+			probes |= 1u << i;
+		}
+	}
+
+	// only claim the probes once the call is known to go ahead
+	for (int i = 0; i < GETLOC_CLASSES; i++)
+	{
+		if (probes & (1u << i))
+		{
+			session->breakers[i].probing = 1;
+		}
+	}
+	pthread_mutex_unlock(&session->breaker_lock);
+
+	return probes;
+}
+
+void getloc_breaker_record(getloc_session *session, unsigned probes, WPS_ReturnCode rc)
+{
+	getloc_class cls = getloc_classify(rc);
+
+	pthread_mutex_lock(&session->breaker_lock);
+	if (rc == WPS_OK)
+	{
+		for (int i = 0; i < GETLOC_CLASSES; i++)
+		{
+			session->breakers[i].state = GETLOC_BREAKER_CLOSED;
+			session->breakers[i].probing = 0;
+			session->breakers[i].failures = 0;
+			session->breakers[i].opens = 0;
+		}
+		pthread_mutex_unlock(&session->breaker_lock);
+		return;
+	}
+
+	// a probe that failed some other way says nothing about its class, the next call probes again
+	for (int i = 0; i < GETLOC_CLASSES; i++)
+	{
+		if ((probes & (1u << i)) && i != (int)cls)
+		{
+			session->breakers[i].probing = 0;
+		}
+	}
+
+	if (cls != GETLOC_CLASS_NONE)
+	{
+		struct getloc_breaker *breaker = &session->breakers[cls];
+		breaker->last = rc;
+		breaker->failures++;
+
+		if (breaker->state == GETLOC_BREAKER_HALF_OPEN && (probes & (1u << cls)))
+		{
+			trip(session, cls);
+		}
+		else if (breaker->state == GETLOC_BREAKER_CLOSED && breaker->failures >= breaker->threshold)
+		{
+			trip(session, cls);
+		}
+	}
+	pthread_mutex_unlock(&session->breaker_lock);
+}
+
+WPS_ReturnCode getloc_breaker_config(getloc_session *session, getloc_class cls, unsigned threshold, unsigned long base, unsigned long max)
+{
+	if (session == NULL || cls < 0 || cls >= GETLOC_CLASSES || threshold == 0 || base == 0 || max < base)
+	{
+		return WPS_NOT_APPLICABLE;
+	}
+
+	pthread_mutex_lock(&session->breaker_lock);
+	session->breakers[cls].threshold = threshold;
+	session->breakers[cls].base = base;
+	session->breakers[cls].max = max;
+	pthread_mutex_unlock(&session->breaker_lock);
+
+	return WPS_OK;
+}
+
+void getloc_breaker_status(getloc_session *session, getloc_class cls, getloc_breaker_info *info)
+{
+	memset(info, 0, sizeof(*info));
+	if (session == NULL || cls < 0 || cls >= GETLOC_CLASSES)
+	{
+		return;
+	}
+
+	unsigned long long now = monotonic_ms();
+
+	pthread_mutex_lock(&session->breaker_lock);
+	struct getloc_breaker *breaker = &session->breakers[cls];
+	info->state = breaker->state;
+	info->failures = breaker->failures;
+	info->opens = breaker->opens;
+	info->rejected = breaker->rejected;
+	info->last = breaker->last;
+	if (breaker->state == GETLOC_BREAKER_OPEN && breaker->open_until > now)
+	{
+		info->retry_in = (unsigned long)(breaker->open_until - now);
+	}
+	pthread_mutex_unlock(&session->breaker_lock);
+}
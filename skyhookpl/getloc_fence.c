@@ -0,0 +1,207 @@
+#include "./getloc_internal.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define QUEUE_MASK (GETLOC_FENCE_QUEUE - 1)
+
+_Static_assert((GETLOC_FENCE_QUEUE & QUEUE_MASK) == 0, "GETLOC_FENCE_QUEUE must be a power of two");
+
+/*
+   * Runs on the WPS thread for every transition.
+   * Events go into a single-producer/single-consumer queue like the fix rings, and the eventfd counter
+   * is bumped so a poll()ing consumer wakes up; a full queue drops the event rather than blocking WPS.
+*/
+static WPS_Continuation geofence_callback(void *arg, const WPS_GeoFence *geofence, const WPS_Location *location, const void *reserved)
+{
+	struct getloc_fence *fence = arg;
+	getloc_session *session = fence->session;
+	(void)reserved;
+
+	getloc_fence_event event;
+	event.fence = fence->id;
+	event.entered = geofence->type == WPS_GEOFENCE_ENTER;
+	getloc_fix_from_location(&event.fix, location);
+
+	if (session->fence_callback != NULL)
+	{
+		session->fence_callback(session->fence_arg, &event);
+	}
+
+	unsigned long head = atomic_load_explicit(&session->fence_head, memory_order_relaxed);
+	unsigned long tail = atomic_load_explicit(&session->fence_tail, memory_order_acquire);
+	if (head - tail < GETLOC_FENCE_QUEUE)
+	{
+		session->fence_queue[head & QUEUE_MASK] = event;
+		atomic_store_explicit(&session->fence_head, head + 1, memory_order_release);
+
+		uint64_t one = 1;
+		if (write(session->fence_fd, &one, sizeof(one)) < 0)
+		{
+			perror("*** getloc fence eventfd");
+		}
+	}
+
+	return WPS_CONTINUE;
+}
+
+static WPS_ReturnCode set_fence(struct getloc_fence *fence, double latitude, double longitude, unsigned radius, unsigned long period, WPS_GeoFenceType type, WPS_GeoFenceHandle *handle)
+{
+	WPS_GeoFence geofence;
+	geofence.size = sizeof(WPS_GeoFence);
+	geofence.latitude = latitude;
+	geofence.longitude = longitude;
+	geofence.radius = radius;
+	geofence.type = type;
+	geofence.period = period;
+
+	unsigned long long begin = getloc_stats_begin();
+	WPS_ReturnCode rc = WPS_geofence_set(&geofence, geofence_callback, fence, handle);
+	getloc_stats_end(GETLOC_CALL_GEOFENCE_SET, begin, rc);
+	if (rc != WPS_OK)
+	{
+		fprintf(stderr, "*** WPS_geofence_set failed (%d)!\n", rc);
+	}
+	return rc;
+}
+
+int getloc_fence_add(getloc_session *session, double latitude, double longitude, unsigned radius, unsigned long period)
+{
+	if (session == NULL || !session->loaded)
+	{
+		return -1;
+	}
+
+	pthread_mutex_lock(&session->sdk_lock);
+	if (session->fence_count == GETLOC_FENCE_MAX)
+	{
+		pthread_mutex_unlock(&session->sdk_lock);
+		return -1;
+	}
+
+	if (session->fence_fd < 0)
+	{
+		session->fence_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (session->fence_fd < 0)
+		{
+			perror("*** getloc_fence_add failed: eventfd");
+			pthread_mutex_unlock(&session->sdk_lock);
+			return -1;
+		}
+	}
+
+	struct getloc_fence *fence = &session->fences[session->fence_count];
+	fence->session = session;
+	fence->id = session->fence_count;
+
+	int id = -1;
+	if (set_fence(fence, latitude, longitude, radius, period, WPS_GEOFENCE_ENTER, &fence->enter) == WPS_OK)
+	{
+		if (set_fence(fence, latitude, longitude, radius, period, WPS_GEOFENCE_LEAVE, &fence->leave) == WPS_OK)
+		{
+			id = session->fence_count++;
+		}
+		else
+		{
+			unsigned long long begin = getloc_stats_begin();
+			WPS_ReturnCode rc = WPS_geofence_cancel(fence->enter);
+			getloc_stats_end(GETLOC_CALL_GEOFENCE_CANCEL, begin, rc);
+		}
+	}
+	pthread_mutex_unlock(&session->sdk_lock);
+
+	return id;
+}
+
+int getloc_fence_fd(getloc_session *session)
+{
+	return session != NULL ? session->fence_fd : -1;
+}
+
+unsigned getloc_fence_drain(getloc_session *session, getloc_fence_event *events, unsigned max)
+{
+	if (session == NULL || session->fence_fd < 0)
+	{
+		return 0;
+	}
+
+	// reset the eventfd before popping, so an event queued meanwhile leaves it readable
+	uint64_t count;
+	if (read(session->fence_fd, &count, sizeof(count)) < 0)
+	{
+		count = 0;
+	}
+
+	unsigned long tail = atomic_load_explicit(&session->fence_tail, memory_order_relaxed);
+	unsigned long head = atomic_load_explicit(&session->fence_head, memory_order_acquire);
+
+	unsigned n = 0;
+	while (tail != head && n < max)
+	{
+		events[n++] = session->fence_queue[tail & QUEUE_MASK];
+		tail++;
+	}
+	atomic_store_explicit(&session->fence_tail, tail, memory_order_release);
+
+	// whatever didn't fit stays queued, keep the eventfd readable for it
+	if (tail != head)
+	{
+		uint64_t one = 1;
+		if (write(session->fence_fd, &one, sizeof(one)) < 0)
+		{
+			perror("*** getloc fence eventfd");
+		}
+	}
+
+	return n;
+}
+
+void getloc_fence_set_callback(getloc_session *session, getloc_fence_callback callback, void *arg)
+{
+	if (session == NULL)
+	{
+		return;
+	}
+	session->fence_callback = callback;
+	session->fence_arg = arg;
+}
+
+WPS_ReturnCode getloc_fence_clear(getloc_session *session)
+{
+	if (session == NULL || !session->loaded)
+	{
+		return WPS_NOT_APPLICABLE;
+	}
+
+	pthread_mutex_lock(&session->sdk_lock);
+	WPS_ReturnCode rc = WPS_OK;
+	if (session->fence_count > 0)
+	{
+		unsigned long long begin = getloc_stats_begin();
+		rc = WPS_geofence_cancel_all();
+		getloc_stats_end(GETLOC_CALL_GEOFENCE_CANCEL, begin, rc);
+		if (rc != WPS_OK)
+		{
+			fprintf(stderr, "*** WPS_geofence_cancel_all failed (%d)!\n", rc);
+		}
+		else
+		{
+			session->fence_count = 0;
+		}
+	}
+	pthread_mutex_unlock(&session->sdk_lock);
+
+	return rc;
+}
+
+void getloc_fence_close(getloc_session *session)
+{
+	getloc_fence_clear(session);
+
+	if (session->fence_fd >= 0)
+	{
+		close(session->fence_fd);
+		session->fence_fd = -1;
+	}
+}
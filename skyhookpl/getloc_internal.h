@@ -0,0 +1,218 @@
+#ifndef _GETLOC_INTERNAL_H_
+#define _GETLOC_INTERNAL_H_
+
+#include "./getlocation.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/*
+   * Single-producer/single-consumer ring of fixes.
+   * The producer only writes head, the consumer only writes tail, so neither side ever takes a lock.
+*/
+typedef struct
+{
+	_Atomic unsigned long head;
+	_Atomic unsigned long tail;
+	_Atomic unsigned long dropped;
+	getloc_fix fixes[GETLOC_STREAM_CAPACITY];
+} getloc_ring;
+
+void getloc_ring_push(getloc_ring *ring, const getloc_fix *fix);
+unsigned getloc_ring_pop(getloc_ring *ring, getloc_fix *fixes, unsigned max);
+int getloc_ring_full(getloc_ring *ring);
+
+struct getloc_session
+{
+	int loaded;
+
+	// the discrete WPS calls made from different threads are serialized on this
+	pthread_mutex_t sdk_lock;
+
+	// streaming mode, see getloc_stream.c
+	getloc_ring ring;
+	pthread_t stream_thread;
+	unsigned long stream_period;
+	_Atomic int streaming; // 1 while the stream runs, 2 while getloc_stream_stop() waits for it, 0 once it is over
+	_Atomic int stream_stop;
+	WPS_ReturnCode stream_rc;
+	unsigned long long stream_begin; // when the previous streamed fix (or the stream itself) began, for GETLOC_CALL_PERIODIC_FIX
+
+	// offline token spool, see getloc_spool.c
+	char *spool_path;
+	unsigned char spool_key[GETLOC_SPOOL_KEY_MAX];
+	unsigned spool_key_length;
+	pthread_mutex_t spool_lock; // guards the spool file and the resolver state below
+	pthread_cond_t resolver_wake;
+	pthread_t resolver_thread;
+	unsigned resolver_interval;
+	int resolver_running;
+	int resolver_stop;
+	int online; // set when a fix succeeds, so the resolver retries right away
+	_Atomic unsigned long spool_pending;
+	getloc_ring resolved;
+
+	// tile cache, see getloc_tiles.c
+	char *tile_dir;
+	_Atomic unsigned long tile_downloads;
+	_Atomic unsigned long tile_skipped;
+	_Atomic unsigned long tile_hits;
+	_Atomic unsigned long tile_misses;
+	unsigned tile_next; // next tileNumber expected by the tiling callback
+	unsigned tile_total;
+	unsigned long stream_downloads; // tile_downloads as of the previous streamed fix
+
+	// geofences, see getloc_fence.c
+	struct getloc_fence
+	{
+		getloc_session *session;
+		int id;
+		WPS_GeoFenceHandle enter;
+		WPS_GeoFenceHandle leave;
+	} fences[GETLOC_FENCE_MAX];
+	int fence_count;
+	int fence_fd;
+	_Atomic unsigned long fence_head;
+	_Atomic unsigned long fence_tail;
+	getloc_fence_event fence_queue[GETLOC_FENCE_QUEUE];
+	getloc_fence_callback fence_callback;
+	void *fence_arg;
+
+	// asynchronous requests, see getloc_async.c
+	struct getloc_async_request
+	{
+		unsigned long id;
+		int ip; // WPS_ip_location() rather than WPS_location()
+		getloc_async_callback callback;
+		void *arg;
+	} async_requests[GETLOC_ASYNC_QUEUE];
+	unsigned long async_next_id;
+	unsigned long async_submitted; // guarded by async_lock, like async_started
+	unsigned long async_started;
+	pthread_mutex_t async_lock;
+	pthread_cond_t async_wake;
+	pthread_t async_thread;
+	int async_running;
+	int async_stop;
+	int async_fd;
+	_Atomic unsigned long async_head;
+	_Atomic unsigned long async_tail;
+	getloc_async_result async_results[GETLOC_ASYNC_QUEUE];
+
+	// the most recent fix, from any source but the spool
+	pthread_mutex_t last_lock;
+	getloc_fix last_fix;
+	int last_known;
+	struct getloc_latest_slot *latest; // shared memory slot it is published to, see getloc_latest.c
+	int latest_fd;                     // holding the lock that makes this session its only writer, while latest is set
+
+	// Kalman filtered track, see getloc_track.c, also guarded by last_lock
+	int track_started;
+	double track_origin[2];   // latitude, longitude of the local plane's origin
+	double track_state[4];    // east, north (m), east, north velocity (m/s)
+	double track_cov[4][4];
+	double track_acceleration;
+	double track_gate;
+	unsigned track_outliers;  // consecutive rejections
+	long long track_observed;
+	unsigned long track_accepted;
+	unsigned long track_rejected;
+
+	// tiered resolver, see getloc_resolve.c
+	pthread_mutex_t resolve_lock;
+	pthread_cond_t resolve_done; // on CLOCK_MONOTONIC
+	unsigned long resolve_wifi;  // Wi-Fi request in flight, 0 if none
+	struct getloc_resolve_waiter *resolve_waiters; // every getloc_resolve() waiting, each for its own request
+
+	// circuit breakers, see getloc_breaker.c
+	pthread_mutex_t breaker_lock;
+	struct getloc_breaker
+	{
+		getloc_breaker_state state;
+		int probing; // the half-open probe is in flight
+		unsigned threshold;
+		unsigned long base;
+		unsigned long max;
+		unsigned failures;
+		unsigned opens;
+		unsigned long long open_until; // CLOCK_MONOTONIC ms
+		unsigned long rejected;
+		WPS_ReturnCode last;
+	} breakers[GETLOC_CLASSES];
+	unsigned breaker_seed; // for the jitter
+};
+
+// fill a fix from a WPS_Location, observed at now minus the location's age
+void getloc_fix_from_location(getloc_fix *fix, const WPS_Location *location);
+
+// WPS_ip_location() into a fix, takes sdk_lock
+WPS_ReturnCode getloc_ip_locate(getloc_session *session, getloc_fix *fix);
+
+// record a fresh fix as the last known one
+void getloc_remember(getloc_session *session, const getloc_fix *fix);
+
+// write a fix into the shared memory slot, if one is published, called with last_lock held
+void getloc_latest_publish(getloc_session *session, const getloc_fix *fix);
+
+// unmap the shared memory slot, the object stays for readers
+void getloc_latest_close(getloc_session *session);
+
+// set the default track configuration
+void getloc_track_init(getloc_session *session);
+
+// feed a fix to the track, called with last_lock held
+void getloc_track_update(getloc_session *session, const getloc_fix *fix);
+
+// same as getloc_async_submit(), for either kind of request
+unsigned long getloc_async_submit_kind(getloc_session *session, int ip, getloc_async_callback callback, void *arg);
+
+// set the default breaker configuration
+void getloc_breaker_init(getloc_session *session);
+
+// whether a WPS_location() (or WPS_ip_location() if ip) may go ahead, returns 0 with *rc set if a breaker is open
+// or the classes being probed, plus GETLOC_BREAKER_ALLOWED, to pass to getloc_breaker_record() with the result
+#define GETLOC_BREAKER_ALLOWED (1 << GETLOC_CLASSES)
+unsigned getloc_breaker_allow(getloc_session *session, int ip, WPS_ReturnCode *rc);
+void getloc_breaker_record(getloc_session *session, unsigned probes, WPS_ReturnCode rc);
+
+// called with sdk_lock held after a WPS call, spools a token when the server can't be reached
+void getloc_spool_on_result(getloc_session *session, WPS_ReturnCode rc);
+
+// let the resolver have a go at the spooled tokens now, e.g. once a stream has stopped
+void getloc_spool_wake(getloc_session *session);
+
+// count a fix as a tile hit or miss, given tile_downloads from when it was started
+void getloc_tiles_account(getloc_session *session, unsigned long downloads_before);
+
+// release the tile directory
+void getloc_tiles_close(getloc_session *session);
+
+// stop the resolver and forget the spool configuration
+void getloc_spool_close(getloc_session *session);
+
+// cancel every fence and close the eventfd
+void getloc_fence_close(getloc_session *session);
+
+// wait for the request in flight and stop the worker
+void getloc_async_close(getloc_session *session);
+
+// monotonic clock in nanoseconds, for timing WPS calls
+static inline unsigned long long getloc_stats_begin()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// record a WPS call that started at begin
+void getloc_stats_end(getloc_call call, unsigned long long begin, WPS_ReturnCode rc);
+
+// wall clock in milliseconds since the unix epoch
+static inline long long getloc_now_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+#endif // _GETLOC_INTERNAL_H_
@@ -0,0 +1,186 @@
+#include "./getloc_internal.h"
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define LATEST_MAGIC 0x4c415453 // "LATS"
+#define LATEST_TRIES 100
+
+/*
+   * Seqlock: the writer makes sequence odd, copies the fix, and makes it even again.
+   * A reader that saw the same even sequence before and after its copy got a consistent fix.
+   * There is one writer per slot, the process holding the session, and it writes under last_lock; a publisher
+   * keeps an exclusive flock() on the object for as long as it publishes, so a second one fails instead of
+   * interleaving its writes with the first one's.
+*/
+struct getloc_latest_slot
+{
+	unsigned int magic;
+	unsigned int version; // GETLOC_FIX_VERSION of the fixes written
+	_Atomic unsigned long sequence;
+	getloc_fix fix;
+};
+
+// map the slot, for writing if create is set, in which case the locked fd is left in lock_fd
+static struct getloc_latest_slot *map_slot(const char *name, int create, int *lock_fd)
+{
+	int fd = create ? shm_open(name, O_RDWR | O_CREAT, 0644) : shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+	{
+		if (create)
+		{
+			perror("*** getloc_publish failed: shm_open");
+		}
+		return NULL;
+	}
+	if (create && flock(fd, LOCK_EX | LOCK_NB) != 0)
+	{
+		fprintf(stderr, "*** getloc_publish failed: %s already has a publisher (getlocd?)!\n", name);
+		close(fd);
+		return NULL;
+	}
+	if (create && ftruncate(fd, sizeof(struct getloc_latest_slot)) != 0)
+	{
+		perror("*** getloc_publish failed: ftruncate");
+		close(fd);
+		return NULL;
+	}
+
+	void *slot = mmap(NULL, sizeof(struct getloc_latest_slot), create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+	if (slot == MAP_FAILED || !create)
+	{
+		close(fd);
+		return slot != MAP_FAILED ? slot : NULL;
+	}
+	*lock_fd = fd;
+	return slot;
+}
+
+// stop publishing, with last_lock held
+static void unmap_slot(getloc_session *session)
+{
+	if (session->latest != NULL)
+	{
+		munmap(session->latest, sizeof(*session->latest));
+		close(session->latest_fd);
+		session->latest = NULL;
+	}
+}
+
+WPS_ReturnCode getloc_publish(getloc_session *session, const char *name)
+{
+	if (session == NULL || !session->loaded)
+	{
+		return WPS_NOT_APPLICABLE;
+	}
+
+	// the previous slot goes first, publishing to the same name again mustn't find it locked by this session
+	pthread_mutex_lock(&session->last_lock);
+	unmap_slot(session);
+	int fd;
+	struct getloc_latest_slot *slot = map_slot(name != NULL ? name : GETLOC_LATEST_NAME, 1, &fd);
+	if (slot == NULL)
+	{
+		pthread_mutex_unlock(&session->last_lock);
+		return WPS_ERROR;
+	}
+	session->latest = slot;
+	session->latest_fd = fd;
+	slot->magic = LATEST_MAGIC;
+	slot->version = GETLOC_FIX_VERSION;
+	if (session->last_known)
+	{
+		getloc_latest_publish(session, &session->last_fix);
+	}
+	pthread_mutex_unlock(&session->last_lock);
+
+	return WPS_OK;
+}
+
+void getloc_latest_publish(getloc_session *session, const getloc_fix *fix)
+{
+	struct getloc_latest_slot *slot = session->latest;
+	if (slot == NULL)
+	{
+		return;
+	}
+
+	// start from an even sequence, in case a previous publisher died mid-write
+	unsigned long sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+	sequence += sequence & 1;
+
+	atomic_store_explicit(&slot->sequence, sequence + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	memcpy(&slot->fix, fix, sizeof(*fix));
+	atomic_store_explicit(&slot->sequence, sequence + 2, memory_order_release);
+}
+
+void getloc_latest_close(getloc_session *session)
+{
+	pthread_mutex_lock(&session->last_lock);
+	unmap_slot(session);
+	pthread_mutex_unlock(&session->last_lock);
+}
+
+WPS_ReturnCode getloc_latest(const char *name, getloc_fix *fix)
+{
+	static _Atomic(const struct getloc_latest_slot *) mapped = NULL;
+	static pthread_mutex_t map_lock = PTHREAD_MUTEX_INITIALIZER;
+
+	const struct getloc_latest_slot *slot = atomic_load_explicit(&mapped, memory_order_acquire);
+	if (slot == NULL)
+	{
+		// keep trying until a publisher has created the object, then keep the mapping for good
+		pthread_mutex_lock(&map_lock);
+		slot = atomic_load_explicit(&mapped, memory_order_relaxed);
+		if (slot == NULL)
+		{
+			slot = map_slot(name != NULL ? name : GETLOC_LATEST_NAME, 0, NULL);
+			atomic_store_explicit(&mapped, slot, memory_order_release);
+		}
+		pthread_mutex_unlock(&map_lock);
+		if (slot == NULL)
+		{
+			return WPS_ERROR_SERVER_UNAVAILABLE;
+		}
+	}
+
+	if (slot->magic != LATEST_MAGIC || slot->version != GETLOC_FIX_VERSION)
+	{
+		return WPS_ERROR_SERVER_UNAVAILABLE;
+	}
+
+	// a writer preempted mid-copy holds readers up, a dead one would hold them forever, so give up eventually
+	getloc_fix copy;
+	unsigned long before, after;
+	int tries = 0;
+	do
+	{
+		if (tries++ == LATEST_TRIES)
+		{
+			return WPS_ERROR_SERVER_UNAVAILABLE;
+		}
+		if (tries > 1)
+		{
+			sched_yield();
+		}
+		before = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		memcpy(&copy, (const void *)&slot->fix, sizeof(copy));
+		atomic_thread_fence(memory_order_acquire);
+		after = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+	} while ((before & 1) || before != after);
+
+	if (before == 0)
+	{
+		return WPS_ERROR_LOCATION_CANNOT_BE_DETERMINED;
+	}
+
+	long long age = getloc_now_ms() - copy.observed;
+	copy.age = age > 0 ? (unsigned int)age : 0;
+	*fix = copy;
+	return WPS_OK;
+}
@@ -0,0 +1,62 @@
+#include "./getlocation.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+WPS_ReturnCode getloc_remote_locate(const char *path, getloc_fix *fix)
+{
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, path != NULL ? path : GETLOCD_SOCKET, sizeof(address.sun_path) - 1);
+
+	int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+	{
+		perror("*** getloc_remote_locate failed: socket");
+		return WPS_ERROR;
+	}
+	if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+	{
+		close(fd);
+		return WPS_ERROR_SERVER_UNAVAILABLE;
+	}
+
+	// getlocd answers from memory, so a reply that takes longer means it is stuck
+	struct timeval timeout = {GETLOCD_TIMEOUT_MS / 1000, (GETLOCD_TIMEOUT_MS % 1000) * 1000};
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0)
+	{
+		perror("*** getloc_remote_locate failed: setsockopt");
+		close(fd);
+		return WPS_ERROR;
+	}
+
+	getloc_remote_reply reply;
+	char request = 0;
+	if (send(fd, &request, 1, MSG_NOSIGNAL) != 1)
+	{
+		close(fd);
+		return WPS_ERROR_SERVER_UNAVAILABLE;
+	}
+	ssize_t received = recv(fd, &reply, sizeof(reply), 0);
+	if (received != (ssize_t)sizeof(reply))
+	{
+		if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			fprintf(stderr, "*** getloc_remote_locate failed: getlocd did not answer within %d ms!\n", GETLOCD_TIMEOUT_MS);
+		}
+		close(fd);
+		return WPS_ERROR_SERVER_UNAVAILABLE;
+	}
+	close(fd);
+
+	if (reply.rc == WPS_OK)
+	{
+		*fix = reply.fix;
+	}
+	return reply.rc;
+}
@@ -0,0 +1,126 @@
+#include "./getloc_internal.h"
+
+// a getloc_resolve() waiting for request id, on its stack; several may wait for the same Wi-Fi request
+struct getloc_resolve_waiter
+{
+	unsigned long id;
+	int done;
+	getloc_async_result result;
+	struct getloc_resolve_waiter *next;
+};
+
+// runs on the async worker, hands the result to every getloc_resolve() waiting on it
+static void resolve_callback(void *arg, const getloc_async_result *result)
+{
+	getloc_session *session = arg;
+
+	pthread_mutex_lock(&session->resolve_lock);
+	for (struct getloc_resolve_waiter *waiter = session->resolve_waiters; waiter != NULL; waiter = waiter->next)
+	{
+		if (waiter->id == result->id)
+		{
+			waiter->result = *result;
+			waiter->done = 1;
+		}
+	}
+	if (session->resolve_wifi == result->id)
+	{
+		session->resolve_wifi = 0;
+	}
+	pthread_cond_broadcast(&session->resolve_done);
+	pthread_mutex_unlock(&session->resolve_lock);
+}
+
+// wait with resolve_lock held for request id to complete into waiter, returns 0 if the deadline passed first;
+// the request can't complete before this is called, its callback needs resolve_lock too
+static int resolve_wait(getloc_session *session, struct getloc_resolve_waiter *waiter, unsigned long id, const struct timespec *deadline)
+{
+	waiter->id = id;
+	waiter->done = 0;
+	waiter->next = session->resolve_waiters;
+	session->resolve_waiters = waiter;
+
+	while (!waiter->done)
+	{
+		if (pthread_cond_timedwait(&session->resolve_done, &session->resolve_lock, deadline) != 0)
+		{
+			break;
+		}
+	}
+
+	struct getloc_resolve_waiter **link = &session->resolve_waiters;
+	while (*link != waiter)
+	{
+		link = &(*link)->next;
+	}
+	*link = waiter->next;
+	return waiter->done;
+}
+
+WPS_ReturnCode getloc_resolve(getloc_session *session, unsigned long deadline, getloc_fix *fix)
+{
+	if (session == NULL || !session->loaded)
+	{
+		return WPS_NOT_APPLICABLE;
+	}
+
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	end.tv_sec += deadline / 1000;
+	end.tv_nsec += (long)(deadline % 1000) * 1000000;
+	if (end.tv_nsec >= 1000000000)
+	{
+		end.tv_sec++;
+		end.tv_nsec -= 1000000000;
+	}
+
+	struct getloc_resolve_waiter waiter;
+	pthread_mutex_lock(&session->resolve_lock);
+
+	// tier 1: Wi-Fi, joining a scan a previous call left running if there is one
+	if (session->resolve_wifi == 0)
+	{
+		session->resolve_wifi = getloc_async_submit_kind(session, 0, resolve_callback, session);
+	}
+	unsigned long id = session->resolve_wifi;
+
+	int wifi_failed = 0;
+	if (id != 0 && resolve_wait(session, &waiter, id, &end))
+	{
+		if (waiter.result.rc == WPS_OK)
+		{
+			*fix = waiter.result.fix;
+			pthread_mutex_unlock(&session->resolve_lock);
+			return WPS_OK;
+		}
+		wifi_failed = 1;
+	}
+
+	// tier 2: IP, only worth asking if Wi-Fi gave up before the deadline
+	if (wifi_failed)
+	{
+		id = getloc_async_submit_kind(session, 1, resolve_callback, session);
+		if (id != 0 && resolve_wait(session, &waiter, id, &end) && waiter.result.rc == WPS_OK)
+		{
+			*fix = waiter.result.fix;
+			pthread_mutex_unlock(&session->resolve_lock);
+			return WPS_OK;
+		}
+	}
+	pthread_mutex_unlock(&session->resolve_lock);
+
+	// tier 3: whatever we knew last, aged to now
+	WPS_ReturnCode rc = WPS_ERROR_TIMEOUT;
+	pthread_mutex_lock(&session->last_lock);
+	if (session->last_known)
+	{
+		*fix = session->last_fix;
+		long long age = getloc_now_ms() - fix->observed;
+		fix->age = age > 0 ? (unsigned int)age : 0;
+		fix->source = GETLOC_SOURCE_LAST_KNOWN;
+		rc = WPS_OK;
+	}
+	pthread_mutex_unlock(&session->last_lock);
+
+	return rc;
+}
@@ -0,0 +1,54 @@
+#include "./getloc_internal.h"
+#include <string.h>
+
+#define RING_MASK (GETLOC_STREAM_CAPACITY - 1)
+
+_Static_assert((GETLOC_STREAM_CAPACITY & RING_MASK) == 0, "GETLOC_STREAM_CAPACITY must be a power of two");
+
+// producer side, only ever called from the ring's one producer thread
+void getloc_ring_push(getloc_ring *ring, const getloc_fix *fix)
+{
+	unsigned long head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	unsigned long tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+	if (head - tail == GETLOC_STREAM_CAPACITY)
+	{
+		atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+		return;
+	}
+
+	ring->fixes[head & RING_MASK] = *fix;
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// consumer side, copies out everything available in at most two memcpy's
+unsigned getloc_ring_pop(getloc_ring *ring, getloc_fix *fixes, unsigned max)
+{
+	unsigned long tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	unsigned long head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+	unsigned long available = head - tail;
+	unsigned n = available < max ? (unsigned)available : max;
+	if (n == 0)
+	{
+		return 0;
+	}
+
+	unsigned start = tail & RING_MASK;
+	unsigned first = GETLOC_STREAM_CAPACITY - start;
+	if (first > n)
+	{
+		first = n;
+	}
+	memcpy(fixes, &ring->fixes[start], first * sizeof(getloc_fix));
+	memcpy(fixes + first, &ring->fixes[0], (n - first) * sizeof(getloc_fix));
+
+	atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+	return n;
+}
+
+int getloc_ring_full(getloc_ring *ring)
+{
+	unsigned long tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+	return atomic_load_explicit(&ring->head, memory_order_relaxed) - tail == GETLOC_STREAM_CAPACITY;
+}
@@ -0,0 +1,410 @@
+#include "./getloc_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+   * The spool is a flat append-only file of records, each a spool_header followed by token_size bytes of token.
+   * Records are appended with a single write() and fsync'd, and the resolver rewrites the file
+   * (to a temporary file that is renamed over it) once it has consumed records from the front.
+   *
+   * Lock order is sdk_lock -> spool_lock, the resolver never calls into WPS while holding spool_lock.
+*/
+#define SPOOL_MAGIC 0x4c4f5053 // "SPOL"
+#define SPOOL_TOKEN_MAX 4096
+#define SPOOL_TOKEN_TTL_MS (90LL * 24 * 60 * 60 * 1000)
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t token_size;
+	int64_t observed; // unix time in milliseconds when the token was captured
+} spool_header;
+
+static int is_offline(WPS_ReturnCode rc)
+{
+	return rc == WPS_ERROR_SERVER_UNAVAILABLE || rc == WPS_ERROR_TIMEOUT;
+}
+
+// read the whole spool file, returns NULL if it is missing or empty
+static unsigned char *read_spool(const char *path, size_t *size)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return NULL;
+	}
+
+	struct stat st;
+	unsigned char *data = NULL;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		data = malloc(st.st_size);
+		if (data != NULL && read(fd, data, st.st_size) != st.st_size)
+		{
+			free(data);
+			data = NULL;
+		}
+		*size = st.st_size;
+	}
+	close(fd);
+	return data;
+}
+
+// number of complete records in a spool image, stops at the first damaged one
+static size_t count_records(const unsigned char *data, size_t size, size_t *valid)
+{
+	size_t count = 0;
+	size_t offset = 0;
+	while (offset + sizeof(spool_header) <= size)
+	{
+		spool_header header;
+		memcpy(&header, data + offset, sizeof(header));
+		if (header.magic != SPOOL_MAGIC || header.token_size > SPOOL_TOKEN_MAX || offset + sizeof(header) + header.token_size > size)
+		{
+			break;
+		}
+		offset += sizeof(header) + header.token_size;
+		count++;
+	}
+	*valid = offset;
+	return count;
+}
+
+// capture a token for the fix that just failed, called with sdk_lock held
+static void spool_capture(getloc_session *session)
+{
+	unsigned char *token;
+	unsigned token_size;
+
+	unsigned long long begin = getloc_stats_begin();
+	WPS_ReturnCode rc = WPS_offline_token(NULL, session->spool_key, session->spool_key_length, &token, &token_size);
+	getloc_stats_end(GETLOC_CALL_OFFLINE_TOKEN, begin, rc);
+	if (rc != WPS_OK)
+	{
+		fprintf(stderr, "*** WPS_offline_token failed (%d)!\n", rc);
+		return;
+	}
+
+	if (token_size <= SPOOL_TOKEN_MAX)
+	{
+		// header and token go out in one write so a crash can only ever truncate the last record
+		unsigned char record[sizeof(spool_header) + SPOOL_TOKEN_MAX];
+		spool_header header = { SPOOL_MAGIC, token_size, getloc_now_ms() };
+		memcpy(record, &header, sizeof(header));
+		memcpy(record + sizeof(header), token, token_size);
+
+		pthread_mutex_lock(&session->spool_lock);
+		int fd = open(session->spool_path, O_WRONLY | O_APPEND | O_CREAT, 0600);
+		if (fd >= 0 && write(fd, record, sizeof(header) + token_size) == (ssize_t)(sizeof(header) + token_size))
+		{
+			fsync(fd);
+			atomic_fetch_add(&session->spool_pending, 1);
+		}
+		else
+		{
+			fprintf(stderr, "*** getloc spool append failed (%s)!\n", strerror(errno));
+		}
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		pthread_mutex_unlock(&session->spool_lock);
+	}
+
+	WPS_free_offline_token(token);
+}
+
+void getloc_spool_on_result(getloc_session *session, WPS_ReturnCode rc)
+{
+	if (session->spool_path == NULL)
+	{
+		return;
+	}
+
+	if (is_offline(rc))
+	{
+		spool_capture(session);
+	}
+	else if (rc == WPS_OK)
+	{
+		// connectivity is back, let the resolver have a go right away (it waits for a stream to stop)
+		getloc_spool_wake(session);
+	}
+}
+
+void getloc_spool_wake(getloc_session *session)
+{
+	if (session->spool_path == NULL || atomic_load(&session->spool_pending) == 0)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&session->spool_lock);
+	session->online = 1;
+	pthread_cond_signal(&session->resolver_wake);
+	pthread_mutex_unlock(&session->spool_lock);
+}
+
+// make a rename in the directory of path durable
+static void sync_directory(const char *path)
+{
+	size_t length = strlen(path);
+	char copy[length + 1];
+	memcpy(copy, path, length + 1);
+
+	int fd = open(dirname(copy), O_RDONLY | O_DIRECTORY);
+	if (fd >= 0)
+	{
+		fsync(fd);
+		close(fd);
+	}
+}
+
+// drop the first consumed bytes of the spool, keeping anything appended since it was read
+static void spool_truncate_front(getloc_session *session, size_t consumed)
+{
+	size_t size = 0;
+	unsigned char *data = read_spool(session->spool_path, &size);
+	if (data == NULL)
+	{
+		return;
+	}
+
+	size_t length = strlen(session->spool_path);
+	char tmp[length + 5];
+	memcpy(tmp, session->spool_path, length);
+	memcpy(tmp + length, ".tmp", 5);
+
+	int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd >= 0)
+	{
+		size_t remaining = consumed < size ? size - consumed : 0;
+		if (write(fd, data + consumed, remaining) == (ssize_t)remaining && fsync(fd) == 0)
+		{
+			close(fd);
+			if (rename(tmp, session->spool_path) == 0)
+			{
+				sync_directory(session->spool_path);
+			}
+		}
+		else
+		{
+			close(fd);
+			unlink(tmp);
+		}
+	}
+	free(data);
+}
+
+// resolve as many spooled tokens as possible, stops at the first one that fails because we're still offline
+static void spool_resolve(getloc_session *session)
+{
+	pthread_mutex_lock(&session->spool_lock);
+	size_t size = 0;
+	unsigned char *data = read_spool(session->spool_path, &size);
+	pthread_mutex_unlock(&session->spool_lock);
+	if (data == NULL)
+	{
+		return;
+	}
+
+	size_t valid;
+	count_records(data, size, &valid);
+
+	size_t offset = 0;
+	unsigned long consumed = 0;
+	while (offset < valid && !getloc_ring_full(&session->resolved))
+	{
+		spool_header header;
+		memcpy(&header, data + offset, sizeof(header));
+		const unsigned char *token = data + offset + sizeof(header);
+
+		WPS_Location *location = NULL;
+		WPS_ReturnCode rc = WPS_ERROR;
+		int expired = getloc_now_ms() - header.observed >= SPOOL_TOKEN_TTL_MS;
+		if (!expired)
+		{
+			// the WPS API is busy with WPS_periodic_location(), the tokens stay spooled until the stream stops
+			pthread_mutex_lock(&session->sdk_lock);
+			if (atomic_load(&session->streaming))
+			{
+				pthread_mutex_unlock(&session->sdk_lock);
+				break;
+			}
+			unsigned long long begin = getloc_stats_begin();
+			rc = WPS_offline_location(NULL, session->spool_key, session->spool_key_length, token, header.token_size, &location);
+			getloc_stats_end(GETLOC_CALL_OFFLINE_LOCATION, begin, rc);
+			pthread_mutex_unlock(&session->sdk_lock);
+		}
+
+		if (is_offline(rc))
+		{
+			break;
+		}
+
+		if (rc == WPS_OK)
+		{
+			getloc_fix fix;
+			getloc_fix_from_location(&fix, location);
+			fix.observed = header.observed;
+			fix.source = GETLOC_SOURCE_OFFLINE;
+			getloc_ring_push(&session->resolved, &fix);
+			WPS_free_location(location);
+		}
+		else if (expired)
+		{
+			fprintf(stderr, "*** spooled token expired, dropping it!\n");
+		}
+		else
+		{
+			fprintf(stderr, "*** WPS_offline_location failed (%d), dropping spooled token!\n", rc);
+		}
+
+		offset += sizeof(header) + header.token_size;
+		consumed++;
+	}
+	free(data);
+
+	if (offset > 0)
+	{
+		pthread_mutex_lock(&session->spool_lock);
+		spool_truncate_front(session, offset);
+		atomic_fetch_sub(&session->spool_pending, consumed);
+		pthread_mutex_unlock(&session->spool_lock);
+	}
+}
+
+static void *resolver_main(void *arg)
+{
+	getloc_session *session = arg;
+
+	pthread_mutex_lock(&session->spool_lock);
+	while (!session->resolver_stop)
+	{
+		if (!session->online)
+		{
+			struct timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_sec += session->resolver_interval;
+			pthread_cond_timedwait(&session->resolver_wake, &session->spool_lock, &deadline);
+		}
+		session->online = 0;
+
+		// the WPS API only takes one call at a time, a stream has to stop first (which wakes the resolver)
+		if (session->resolver_stop || atomic_load(&session->spool_pending) == 0 || atomic_load(&session->streaming))
+		{
+			continue;
+		}
+
+		pthread_mutex_unlock(&session->spool_lock);
+		spool_resolve(session);
+		pthread_mutex_lock(&session->spool_lock);
+	}
+	pthread_mutex_unlock(&session->spool_lock);
+	return NULL;
+}
+
+WPS_ReturnCode getloc_spool_open(getloc_session *session, const char *path, const unsigned char *key, unsigned key_length, unsigned interval)
+{
+	if (session == NULL || !session->loaded || path == NULL || key == NULL || key_length == 0 || key_length > GETLOC_SPOOL_KEY_MAX || interval == 0)
+	{
+		return WPS_NOT_APPLICABLE;
+	}
+	if (session->spool_path != NULL)
+	{
+		return WPS_NOT_APPLICABLE;
+	}
+
+	char *copy = strdup(path);
+	if (copy == NULL)
+	{
+		return WPS_NOMEM;
+	}
+
+	// pick up whatever a previous run left behind, less a damaged tail (from a crash mid-append),
+	// which records appended after it would otherwise be stuck behind
+	size_t size = 0;
+	size_t valid;
+	unsigned long pending = 0;
+	unsigned char *data = read_spool(path, &size);
+	if (data != NULL)
+	{
+		pending = count_records(data, size, &valid);
+		free(data);
+		if (valid < size && truncate(path, (off_t)valid) != 0)
+		{
+			fprintf(stderr, "*** getloc_spool_open failed: could not truncate the damaged tail of %s (%s)!\n", path, strerror(errno));
+			free(copy);
+			return WPS_ERROR;
+		}
+	}
+
+	memcpy(session->spool_key, key, key_length);
+	session->spool_key_length = key_length;
+	session->resolver_interval = interval;
+	session->resolver_stop = 0;
+	session->online = pending > 0;
+	atomic_store(&session->spool_pending, pending);
+
+	// publishing the path is what enables capturing, and the resolver reads it too, so it goes first
+	pthread_mutex_lock(&session->sdk_lock);
+	session->spool_path = copy;
+	pthread_mutex_unlock(&session->sdk_lock);
+
+	if (pthread_create(&session->resolver_thread, NULL, resolver_main, session) != 0)
+	{
+		fprintf(stderr, "*** getloc_spool_open failed: could not create the resolver thread!\n");
+		pthread_mutex_lock(&session->sdk_lock);
+		session->spool_path = NULL;
+		pthread_mutex_unlock(&session->sdk_lock);
+		free(copy);
+		return WPS_ERROR;
+	}
+	session->resolver_running = 1;
+
+	return WPS_OK;
+}
+
+unsigned getloc_spool_drain(getloc_session *session, getloc_fix *fixes, unsigned max)
+{
+	if (session == NULL)
+	{
+		return 0;
+	}
+	return getloc_ring_pop(&session->resolved, fixes, max);
+}
+
+unsigned long getloc_spool_pending(getloc_session *session)
+{
+	if (session == NULL)
+	{
+		return 0;
+	}
+	return atomic_load(&session->spool_pending);
+}
+
+void getloc_spool_close(getloc_session *session)
+{
+	if (session->resolver_running)
+	{
+		pthread_mutex_lock(&session->spool_lock);
+		session->resolver_stop = 1;
+		pthread_cond_signal(&session->resolver_wake);
+		pthread_mutex_unlock(&session->spool_lock);
+
+		pthread_join(session->resolver_thread, NULL);
+		session->resolver_running = 0;
+	}
+
+	pthread_mutex_lock(&session->sdk_lock);
+	free(session->spool_path);
+	session->spool_path = NULL;
+	pthread_mutex_unlock(&session->sdk_lock);
+}
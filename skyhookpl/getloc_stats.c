@@ -0,0 +1,140 @@
+#include "./getloc_internal.h"
+#include <string.h>
+
+/*
+   * One histogram per WPS call, process-wide like the WPS API itself.
+   * Recording is a handful of relaxed atomic adds, readers just copy the counters out,
+   * so a snapshot taken while calls are running can be off by the calls in flight but never blocks them.
+*/
+static struct
+{
+	_Atomic unsigned long long count;
+	_Atomic unsigned long long sum;
+	_Atomic unsigned long long max;
+	_Atomic unsigned long long codes[GETLOC_CODES];
+	_Atomic unsigned long long buckets[GETLOC_HIST_BUCKETS];
+} stats[GETLOC_CALLS];
+
+static const char *names[GETLOC_CALLS] = {
+	"WPS_load",
+	"WPS_set_key",
+	"WPS_location",
+	"WPS_ip_location",
+	"WPS_periodic_location",
+	"periodic fix",
+	"WPS_offline_token",
+	"WPS_offline_location",
+	"WPS_set_tiling",
+	"WPS_geofence_set",
+	"WPS_geofence_cancel",
+	"WPS_unload",
+};
+
+// below GETLOC_HIST_SUB every value has its own bucket, above it each power of two gets GETLOC_HIST_SUB of them
+static unsigned bucket_index(unsigned long long value)
+{
+	if (value < GETLOC_HIST_SUB)
+	{
+		return (unsigned)value;
+	}
+
+	unsigned msb = 63 - __builtin_clzll(value);
+	unsigned index = (msb - GETLOC_HIST_SUB_BITS + 1) * GETLOC_HIST_SUB + (unsigned)((value >> (msb - GETLOC_HIST_SUB_BITS)) & (GETLOC_HIST_SUB - 1));
+	return index < GETLOC_HIST_BUCKETS ? index : GETLOC_HIST_BUCKETS - 1;
+}
+
+static unsigned long long bucket_lower(unsigned index)
+{
+	if (index < GETLOC_HIST_SUB)
+	{
+		return index;
+	}
+
+	unsigned msb = index / GETLOC_HIST_SUB + GETLOC_HIST_SUB_BITS - 1;
+	return (unsigned long long)(GETLOC_HIST_SUB + index % GETLOC_HIST_SUB) << (msb - GETLOC_HIST_SUB_BITS);
+}
+
+unsigned getloc_stats_code_index(WPS_ReturnCode rc)
+{
+	if (rc >= WPS_OK && rc <= WPS_ERROR_LOCATION_NOT_PERMITTED)
+	{
+		return (unsigned)rc;
+	}
+	if (rc == WPS_NOMEM)
+	{
+		return GETLOC_CODES - 3;
+	}
+	if (rc == WPS_ERROR)
+	{
+		return GETLOC_CODES - 2;
+	}
+	return GETLOC_CODES - 1;
+}
+
+void getloc_stats_end(getloc_call call, unsigned long long begin, WPS_ReturnCode rc)
+{
+	unsigned long long elapsed = getloc_stats_begin() - begin;
+
+	atomic_fetch_add_explicit(&stats[call].count, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&stats[call].sum, elapsed, memory_order_relaxed);
+	atomic_fetch_add_explicit(&stats[call].codes[getloc_stats_code_index(rc)], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&stats[call].buckets[bucket_index(elapsed)], 1, memory_order_relaxed);
+
+	unsigned long long max = atomic_load_explicit(&stats[call].max, memory_order_relaxed);
+	while (elapsed > max && !atomic_compare_exchange_weak_explicit(&stats[call].max, &max, elapsed, memory_order_relaxed, memory_order_relaxed))
+	{
+	}
+}
+
+const char *getloc_call_name(getloc_call call)
+{
+	return call < GETLOC_CALLS ? names[call] : "?";
+}
+
+void getloc_stats_snapshot(getloc_call call, getloc_call_stats *snapshot)
+{
+	memset(snapshot, 0, sizeof(*snapshot));
+	if (call >= GETLOC_CALLS)
+	{
+		return;
+	}
+
+	snapshot->count = atomic_load_explicit(&stats[call].count, memory_order_relaxed);
+	snapshot->sum = atomic_load_explicit(&stats[call].sum, memory_order_relaxed);
+	snapshot->max = atomic_load_explicit(&stats[call].max, memory_order_relaxed);
+	for (unsigned i = 0; i < GETLOC_CODES; i++)
+	{
+		snapshot->codes[i] = atomic_load_explicit(&stats[call].codes[i], memory_order_relaxed);
+	}
+	for (unsigned i = 0; i < GETLOC_HIST_BUCKETS; i++)
+	{
+		snapshot->buckets[i] = atomic_load_explicit(&stats[call].buckets[i], memory_order_relaxed);
+	}
+}
+
+unsigned long long getloc_stats_quantile(const getloc_call_stats *snapshot, double q)
+{
+	unsigned long long total = 0;
+	for (unsigned i = 0; i < GETLOC_HIST_BUCKETS; i++)
+	{
+		total += snapshot->buckets[i];
+	}
+	if (total == 0)
+	{
+		return 0;
+	}
+
+	// the upper edge of the bucket holding the q'th value, capped at the largest value seen
+	unsigned long long rank = (unsigned long long)(q * (total - 1)) + 1;
+	unsigned long long seen = 0;
+	for (unsigned i = 0; i < GETLOC_HIST_BUCKETS; i++)
+	{
+		seen += snapshot->buckets[i];
+		if (seen >= rank)
+		{
+			unsigned long long upper = i + 1 < GETLOC_HIST_BUCKETS ? bucket_lower(i + 1) - 1 : snapshot->max;
+			return upper < snapshot->max ? upper : snapshot->max;
+		}
+	}
+	return snapshot->max;
+}
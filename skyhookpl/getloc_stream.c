@@ -0,0 +1,136 @@
+#include "./getloc_internal.h"
+#include <stdio.h>
+
+static WPS_Continuation periodic_callback(void *arg, WPS_ReturnCode code, const WPS_Location *location, const void *reserved)
+{
+	getloc_session *session = arg;
+	(void)reserved;
+
+	// how long this fix took to arrive after the previous one, i.e. the period plus the scan
+	getloc_stats_end(GETLOC_CALL_PERIODIC_FIX, session->stream_begin, code);
+	session->stream_begin = getloc_stats_begin();
+
+	if (code == WPS_OK)
+	{
+		getloc_fix fix;
+		getloc_fix_from_location(&fix, location);
+		getloc_ring_push(&session->ring, &fix);
+		getloc_remember(session, &fix);
+
+		getloc_tiles_account(session, session->stream_downloads);
+	}
+	session->stream_downloads = atomic_load(&session->tile_downloads);
+
+	pthread_mutex_lock(&session->sdk_lock);
+	getloc_spool_on_result(session, code);
+	pthread_mutex_unlock(&session->sdk_lock);
+
+	// the SDK keeps its own period, but there is no point streaming with a revoked key or location disabled
+	getloc_breaker_record(session, 0, code);
+	if (getloc_classify(code) == GETLOC_CLASS_FATAL)
+	{
+		getloc_breaker_info fatal;
+		getloc_breaker_status(session, GETLOC_CLASS_FATAL, &fatal);
+		if (fatal.state == GETLOC_BREAKER_OPEN)
+		{
+			fprintf(stderr, "*** getloc stream stopped on %d!\n", code);
+			return WPS_STOP;
+		}
+	}
+
+	return atomic_load(&session->stream_stop) ? WPS_STOP : WPS_CONTINUE;
+}
+
+static void *stream_main(void *arg)
+{
+	getloc_session *session = arg;
+
+	// blocks until the callback returns WPS_STOP or an error occurs while setting up
+	unsigned long long begin = getloc_stats_begin();
+	session->stream_begin = begin;
+	session->stream_rc = WPS_periodic_location(NULL, WPS_NO_STREET_ADDRESS_LOOKUP, session->stream_period, 0, periodic_callback, session);
+	getloc_stats_end(GETLOC_CALL_PERIODIC_LOCATION, begin, session->stream_rc);
+	if (session->stream_rc != WPS_OK)
+	{
+		fprintf(stderr, "*** WPS_periodic_location failed (%d)!\n", session->stream_rc);
+	}
+
+	// ending on its own (a fatal error, or failing to set up) nobody is going to join this thread, so it lets go of
+	// itself and of the session, which can locate or stream again; getloc_stream_stop() only returns stream_rc
+	int running = 1;
+	if (atomic_compare_exchange_strong(&session->streaming, &running, 0))
+	{
+		pthread_detach(pthread_self());
+		getloc_spool_wake(session);
+	}
+	return NULL;
+}
+
+WPS_ReturnCode getloc_stream_start(getloc_session *session, unsigned long period)
+{
+	if (session == NULL || !session->loaded || period == 0)
+	{
+		return WPS_NOT_APPLICABLE;
+	}
+
+	int expected = 0;
+	if (!atomic_compare_exchange_strong(&session->streaming, &expected, 1))
+	{
+		return WPS_NOT_APPLICABLE;
+	}
+
+	atomic_store(&session->stream_stop, 0);
+	session->stream_period = period;
+	session->stream_rc = WPS_OK;
+	session->stream_downloads = atomic_load(&session->tile_downloads);
+
+	if (pthread_create(&session->stream_thread, NULL, stream_main, session) != 0)
+	{
+		fprintf(stderr, "*** getloc_stream_start failed: could not create the stream thread!\n");
+		atomic_store(&session->streaming, 0);
+		return WPS_ERROR;
+	}
+
+	return WPS_OK;
+}
+
+unsigned getloc_stream_drain(getloc_session *session, getloc_fix *fixes, unsigned max)
+{
+	if (session == NULL)
+	{
+		return 0;
+	}
+	return getloc_ring_pop(&session->ring, fixes, max);
+}
+
+unsigned long getloc_stream_dropped(getloc_session *session)
+{
+	if (session == NULL)
+	{
+		return 0;
+	}
+	return atomic_load_explicit(&session->ring.dropped, memory_order_relaxed);
+}
+
+WPS_ReturnCode getloc_stream_stop(getloc_session *session)
+{
+	if (session == NULL)
+	{
+		return WPS_OK;
+	}
+
+	// a stream that ended on its own has cleared streaming and needs no join
+	int running = 1;
+	if (!atomic_compare_exchange_strong(&session->streaming, &running, 2))
+	{
+		return running == 0 ? session->stream_rc : WPS_OK;
+	}
+
+	// the callback picks this up on its next invocation and returns WPS_STOP
+	atomic_store(&session->stream_stop, 1);
+	pthread_join(session->stream_thread, NULL);
+	atomic_store(&session->streaming, 0);
+	getloc_spool_wake(session);
+
+	return session->stream_rc;
+}
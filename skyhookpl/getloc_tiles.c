@@ -0,0 +1,141 @@
+#include "./getloc_internal.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+   * WPS calls this before each tile it downloads, tileNumber runs from 0 to tileTotal (not inclusive)
+   * and tiles that are already on disk are skipped without a callback, so a gap in tileNumber is a cached tile.
+   * A tileNumber that doesn't move forward starts a new batch, at which point the tail of the previous
+   * batch that never got a callback is counted as skipped too.
+*/
+static WPS_Continuation tiling_callback(void *arg, unsigned tileNumber, unsigned tileTotal)
+{
+	getloc_session *session = arg;
+
+	if (tileNumber < session->tile_next)
+	{
+		atomic_fetch_add(&session->tile_skipped, session->tile_total - session->tile_next);
+		session->tile_next = 0;
+	}
+	atomic_fetch_add(&session->tile_skipped, tileNumber - session->tile_next);
+	atomic_fetch_add(&session->tile_downloads, 1);
+
+	session->tile_next = tileNumber + 1;
+	session->tile_total = tileTotal;
+	return WPS_CONTINUE;
+}
+
+static WPS_ReturnCode set_tiling(getloc_session *session, unsigned max_per_session, unsigned max_total)
+{
+	unsigned long long begin = getloc_stats_begin();
+	WPS_ReturnCode rc = WPS_set_tiling(NULL, session->tile_dir, max_per_session, max_total, tiling_callback, session);
+	getloc_stats_end(GETLOC_CALL_SET_TILING, begin, rc);
+	if (rc != WPS_OK)
+	{
+		fprintf(stderr, "*** WPS_set_tiling failed (%d)!\n", rc);
+	}
+	return rc;
+}
+
+WPS_ReturnCode getloc_tiles_open(getloc_session *session, const char *dirpath, unsigned max_per_session, unsigned max_total, unsigned prefetch_tiles)
+{
+	if (session == NULL || !session->loaded || dirpath == NULL || session->tile_dir != NULL)
+	{
+		return WPS_NOT_APPLICABLE;
+	}
+
+	// dirpath must end with a directory separator
+	size_t length = strlen(dirpath);
+	int separator = length > 0 && dirpath[length - 1] == '/';
+	char *dir = malloc(length + 2);
+	if (dir == NULL)
+	{
+		return WPS_NOMEM;
+	}
+	memcpy(dir, dirpath, length + 1);
+	if (!separator)
+	{
+		dir[length] = '/';
+		dir[length + 1] = '\0';
+	}
+
+	pthread_mutex_lock(&session->sdk_lock);
+	session->tile_dir = dir;
+
+	WPS_ReturnCode rc = WPS_OK;
+	if (prefetch_tiles > 0)
+	{
+		// one fix with room for the whole region, then settle on the steady-state budget
+		// saturating, a region of more than 83886 tiles would otherwise wrap around to a small budget
+		unsigned long long bytes = (unsigned long long)prefetch_tiles * GETLOC_TILE_SIZE;
+		unsigned prefetch = bytes < UINT_MAX ? (unsigned)bytes : UINT_MAX;
+		rc = set_tiling(session, prefetch > max_per_session ? prefetch : max_per_session, max_total);
+		if (rc == WPS_OK)
+		{
+			WPS_Location *location;
+			unsigned long long begin = getloc_stats_begin();
+			WPS_ReturnCode prefetch_rc = WPS_location(NULL, WPS_NO_STREET_ADDRESS_LOOKUP, &location);
+			getloc_stats_end(GETLOC_CALL_LOCATION, begin, prefetch_rc);
+			if (prefetch_rc == WPS_OK)
+			{
+				WPS_free_location(location);
+			}
+			else
+			{
+				fprintf(stderr, "*** tile prefetch failed (%d)!\n", prefetch_rc);
+			}
+		}
+	}
+	if (rc == WPS_OK)
+	{
+		rc = set_tiling(session, max_per_session, max_total);
+	}
+
+	if (rc != WPS_OK)
+	{
+		session->tile_dir = NULL;
+		free(dir);
+	}
+	pthread_mutex_unlock(&session->sdk_lock);
+
+	return rc;
+}
+
+void getloc_tiles_account(getloc_session *session, unsigned long downloads_before)
+{
+	if (session->tile_dir == NULL)
+	{
+		return;
+	}
+
+	if (atomic_load(&session->tile_downloads) == downloads_before)
+	{
+		atomic_fetch_add(&session->tile_hits, 1);
+	}
+	else
+	{
+		atomic_fetch_add(&session->tile_misses, 1);
+	}
+}
+
+void getloc_tiles_stats(getloc_session *session, getloc_tile_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	if (session == NULL)
+	{
+		return;
+	}
+
+	stats->downloads = atomic_load(&session->tile_downloads);
+	stats->skipped = atomic_load(&session->tile_skipped);
+	stats->hits = atomic_load(&session->tile_hits);
+	stats->misses = atomic_load(&session->tile_misses);
+}
+
+void getloc_tiles_close(getloc_session *session)
+{
+	free(session->tile_dir);
+	session->tile_dir = NULL;
+}
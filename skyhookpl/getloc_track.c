@@ -0,0 +1,201 @@
+#include "./getloc_internal.h"
+#include <math.h>
+#include <string.h>
+
+#define EARTH_RADIUS_M 6371008.8
+#define DEGREES (M_PI / 180)
+
+void getloc_track_init(getloc_session *session)
+{
+	session->track_acceleration = 0.5;
+	session->track_gate = 3;
+}
+
+// fixes are projected onto a plane tangent at the origin, fine for the few kilometres a unit moves
+static void to_plane(const getloc_session *session, double latitude, double longitude, double *east, double *north)
+{
+	*east = (longitude - session->track_origin[1]) * DEGREES * EARTH_RADIUS_M * cos(session->track_origin[0] * DEGREES);
+	*north = (latitude - session->track_origin[0]) * DEGREES * EARTH_RADIUS_M;
+}
+
+static void from_plane(const getloc_session *session, double east, double north, double *latitude, double *longitude)
+{
+	*latitude = session->track_origin[0] + north / EARTH_RADIUS_M / DEGREES;
+	*longitude = session->track_origin[1] + east / (EARTH_RADIUS_M * cos(session->track_origin[0] * DEGREES)) / DEGREES;
+}
+
+// start over at the fix, with its hpe as the position uncertainty and nothing known about the velocity
+static void restart(getloc_session *session, const getloc_fix *fix)
+{
+	double variance = (double)fix->hpe * fix->hpe;
+
+	session->track_origin[0] = fix->latitude;
+	session->track_origin[1] = fix->longitude;
+	memset(session->track_state, 0, sizeof(session->track_state));
+	memset(session->track_cov, 0, sizeof(session->track_cov));
+	session->track_cov[0][0] = variance;
+	session->track_cov[1][1] = variance;
+	session->track_cov[2][2] = 100; // (10 m/s)^2
+	session->track_cov[3][3] = 100;
+	session->track_outliers = 0;
+	session->track_observed = fix->observed;
+	session->track_started = 1;
+}
+
+// x = F x, P = F P F' + Q for a constant velocity model over dt seconds
+static void predict(getloc_session *session, double dt)
+{
+	double (*P)[4] = session->track_cov;
+	double *x = session->track_state;
+
+	x[0] += dt * x[2];
+	x[1] += dt * x[3];
+
+	// F P F', with F the identity plus dt at (0,2) and (1,3)
+	for (int i = 0; i < 4; i++)
+	{
+		P[0][i] += dt * P[2][i];
+		P[1][i] += dt * P[3][i];
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		P[i][0] += dt * P[i][2];
+		P[i][1] += dt * P[i][3];
+	}
+
+	// white noise acceleration
+	double q = session->track_acceleration * session->track_acceleration;
+	for (int axis = 0; axis < 2; axis++)
+	{
+		P[axis][axis] += q * dt * dt * dt / 3;
+		P[axis][axis + 2] += q * dt * dt / 2;
+		P[axis + 2][axis] += q * dt * dt / 2;
+		P[axis + 2][axis + 2] += q * dt;
+	}
+}
+
+void getloc_track_update(getloc_session *session, const getloc_fix *fix)
+{
+	// IP fixes have no hpe, and an hpe of 0 would pin the track to whatever the fix says
+	if (!(fix->hpe > 0))
+	{
+		return;
+	}
+
+	if (!session->track_started)
+	{
+		restart(session, fix);
+		session->track_accepted++;
+		return;
+	}
+
+	// fixes can arrive slightly out of order from different threads, treat those as simultaneous
+	double dt = (fix->observed - session->track_observed) / 1000.0;
+	double (*P)[4] = session->track_cov;
+	double *x = session->track_state;
+
+	double saved_state[4], saved_cov[4][4];
+	memcpy(saved_state, x, sizeof(saved_state));
+	memcpy(saved_cov, P, sizeof(saved_cov));
+	if (dt > 0)
+	{
+		predict(session, dt);
+	}
+
+	// innovation y = z - H x and its covariance S = H P H' + R
+	double z[2];
+	to_plane(session, fix->latitude, fix->longitude, &z[0], &z[1]);
+	double y[2] = { z[0] - x[0], z[1] - x[1] };
+	double r = (double)fix->hpe * fix->hpe;
+	double S[2][2] = { { P[0][0] + r, P[0][1] }, { P[1][0], P[1][1] + r } };
+	double det = S[0][0] * S[1][1] - S[0][1] * S[1][0];
+	double Si[2][2] = { { S[1][1] / det, -S[0][1] / det }, { -S[1][0] / det, S[0][0] / det } };
+
+	double d2 = y[0] * (Si[0][0] * y[0] + Si[0][1] * y[1]) + y[1] * (Si[1][0] * y[0] + Si[1][1] * y[1]);
+	if (!(d2 <= session->track_gate * session->track_gate))
+	{
+		session->track_rejected++;
+		if (++session->track_outliers >= GETLOC_TRACK_RESET)
+		{
+			restart(session, fix);
+			session->track_accepted++;
+			return;
+		}
+
+		// an outlier doesn't move the track forward in time either
+		memcpy(x, saved_state, sizeof(saved_state));
+		memcpy(P, saved_cov, sizeof(saved_cov));
+		return;
+	}
+
+	// K = P H' S^-1, x += K y, P -= K H P
+	double K[4][2];
+	for (int i = 0; i < 4; i++)
+	{
+		K[i][0] = P[i][0] * Si[0][0] + P[i][1] * Si[1][0];
+		K[i][1] = P[i][0] * Si[0][1] + P[i][1] * Si[1][1];
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		x[i] += K[i][0] * y[0] + K[i][1] * y[1];
+	}
+	double HP[2][4];
+	memcpy(HP, P, sizeof(HP));
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			P[i][j] -= K[i][0] * HP[0][j] + K[i][1] * HP[1][j];
+		}
+	}
+
+	session->track_outliers = 0;
+	if (dt > 0)
+	{
+		session->track_observed = fix->observed;
+	}
+	session->track_accepted++;
+}
+
+WPS_ReturnCode getloc_track_config(getloc_session *session, double acceleration, double gate)
+{
+	if (session == NULL || !(acceleration >= 0) || !(gate > 0))
+	{
+		return WPS_NOT_APPLICABLE;
+	}
+
+	pthread_mutex_lock(&session->last_lock);
+	session->track_acceleration = acceleration;
+	session->track_gate = gate;
+	pthread_mutex_unlock(&session->last_lock);
+
+	return WPS_OK;
+}
+
+int getloc_track_get(getloc_session *session, getloc_track_estimate *estimate)
+{
+	memset(estimate, 0, sizeof(*estimate));
+	if (session == NULL)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&session->last_lock);
+	int started = session->track_started;
+	if (started)
+	{
+		const double *x = session->track_state;
+		from_plane(session, x[0], x[1], &estimate->latitude, &estimate->longitude);
+		estimate->east_velocity = x[2];
+		estimate->north_velocity = x[3];
+		estimate->covariance[0] = session->track_cov[1][1];
+		estimate->covariance[1] = session->track_cov[1][0];
+		estimate->covariance[2] = session->track_cov[0][0];
+		estimate->observed = session->track_observed;
+	}
+	estimate->accepted = session->track_accepted;
+	estimate->rejected = session->track_rejected;
+	pthread_mutex_unlock(&session->last_lock);
+
+	return started;
+}
@@ -1,44 +1,256 @@
-#include "./wpsapi.h"
+#include "./getloc_internal.h"
 #include <stdio.h>
 #include <stdlib.h>
-double *getLocation()
+#include <string.h>
+
+// the WPS API is process-wide, so is the session that owns it
+static getloc_session *open_session = NULL;
+
+getloc_session *getloc_open(const char *key)
 {
+	if (open_session != NULL)
+	{
+		fprintf(stderr, "*** getloc_open failed: a session is already open!\n");
+		return NULL;
+	}
+
+	getloc_session *session = calloc(1, sizeof(*session));
+	if (session == NULL)
+	{
+		return NULL;
+	}
+
 	// initialize the WPS API
-	WPS_load();
+	unsigned long long begin = getloc_stats_begin();
+	WPS_ReturnCode rc = WPS_load();
+	getloc_stats_end(GETLOC_CALL_LOAD, begin, rc);
+	if (rc != WPS_OK)
+	{
+		fprintf(stderr, "*** WPS_load failed (%d)!\n", rc);
+		free(session);
+		return NULL;
+	}
+	session->loaded = 1;
+	pthread_mutex_init(&session->sdk_lock, NULL);
+	getloc_breaker_init(session);
+	getloc_track_init(session);
+	pthread_mutex_init(&session->spool_lock, NULL);
+	pthread_cond_init(&session->resolver_wake, NULL);
+	session->fence_fd = -1;
+	pthread_mutex_init(&session->async_lock, NULL);
+	pthread_cond_init(&session->async_wake, NULL);
+	session->async_fd = -1;
+	pthread_mutex_init(&session->last_lock, NULL);
+	pthread_mutex_init(&session->resolve_lock, NULL);
+	pthread_condattr_t monotonic;
+	pthread_condattr_init(&monotonic);
+	pthread_condattr_setclock(&monotonic, CLOCK_MONOTONIC);
+	pthread_cond_init(&session->resolve_done, &monotonic);
+	pthread_condattr_destroy(&monotonic);
 
 	// set the API key
-	//(found in my.skyhook.com under projects -> the project you're developing)
-	const char *key = "YOUR_KEY_HERE";
-	WPS_set_key(key);
+	begin = getloc_stats_begin();
+	rc = WPS_set_key(key != NULL ? key : GETLOC_KEY);
+	getloc_stats_end(GETLOC_CALL_SET_KEY, begin, rc);
+	if (rc != WPS_OK)
+	{
+		fprintf(stderr, "*** WPS_set_key failed (%d)!\n", rc);
+		getloc_close(session);
+		return NULL;
+	}
+
+	open_session = session;
+	return session;
+}
 
-	// get the location
+WPS_ReturnCode getloc_locate(getloc_session *session, getloc_fix *fix)
+{
+	if (session == NULL || !session->loaded)
+	{
+		return WPS_NOT_APPLICABLE;
+	}
+
+	// the WPS API is busy with WPS_periodic_location()
+	if (atomic_load(&session->streaming))
+	{
+		return WPS_NOT_APPLICABLE;
+	}
+
+	// get the location, unless a breaker says it is bound to fail
 	WPS_Location *location;
 	WPS_ReturnCode rc;
 
+	unsigned probes = getloc_breaker_allow(session, 0, &rc);
+	if (probes == 0)
+	{
+		return rc;
+	}
+
+	pthread_mutex_lock(&session->sdk_lock);
+	unsigned long downloads = atomic_load(&session->tile_downloads);
+	unsigned long long begin = getloc_stats_begin();
 	rc = WPS_location(NULL, WPS_NO_STREET_ADDRESS_LOOKUP, &location);
+	getloc_stats_end(GETLOC_CALL_LOCATION, begin, rc);
+	getloc_spool_on_result(session, rc);
+	pthread_mutex_unlock(&session->sdk_lock);
+	getloc_breaker_record(session, probes, rc);
 	if (rc != WPS_OK)
 	{
 		fprintf(stderr, "*** WPS_location failed (%d)!\n", rc);
+		return rc;
+	}
+	getloc_tiles_account(session, downloads);
+
+	/*
+	   * Units of coordinates are either in DD (Decimal Degrees) (or) in DMS (Degrees, Minutes and Seconds)
+	   * Latitude - North or South of the Equator. If North, then the DD value is positive, otherwise negative.
+	   * Longitude - East or West of the Prime Meridian. If East, then the DD value is positive, otherwise negative.
+	*/
+	getloc_fix_from_location(fix, location);
+	getloc_remember(session, fix);
+
+	// free resources being used by the WPS_location object
+	WPS_free_location(location);
+
+	return WPS_OK;
+}
+
+WPS_ReturnCode getloc_ip_locate(getloc_session *session, getloc_fix *fix)
+{
+	// the WPS API is busy with WPS_periodic_location()
+	if (atomic_load(&session->streaming))
+	{
+		return WPS_NOT_APPLICABLE;
 	}
-	else
+
+	WPS_IPLocation *location;
+	WPS_ReturnCode rc;
+
+	unsigned probes = getloc_breaker_allow(session, 1, &rc);
+	if (probes == 0)
 	{
-		double *coordinates = malloc(sizeof(double) * 2);
-		coordinates[0] = location->longitude;
-		coordinates[1] = location->latitude;
+		return rc;
+	}
+
+	pthread_mutex_lock(&session->sdk_lock);
+	unsigned long long begin = getloc_stats_begin();
+	rc = WPS_ip_location(NULL, WPS_NO_STREET_ADDRESS_LOOKUP, &location);
+	getloc_stats_end(GETLOC_CALL_IP_LOCATION, begin, rc);
+	pthread_mutex_unlock(&session->sdk_lock);
+	getloc_breaker_record(session, probes, rc);
+	if (rc != WPS_OK)
+	{
+		fprintf(stderr, "*** WPS_ip_location failed (%d)!\n", rc);
+		return rc;
+	}
+
+	memset(fix, 0, sizeof(*fix));
+	fix->version = GETLOC_FIX_VERSION;
+	fix->latitude = location->latitude;
+	fix->longitude = location->longitude;
+	fix->hpe = -1;
+	fix->speed = -1;
+	fix->bearing = -1;
+	fix->observed = getloc_now_ms();
+	fix->source = GETLOC_SOURCE_IP;
 
-		// free resources being used by the WPS_location object
-		WPS_free_location(location);
+	WPS_free_ip_location(location);
+	getloc_remember(session, fix);
 
-		// free all resources being used by the WPS API
+	return WPS_OK;
+}
+
+void getloc_remember(getloc_session *session, const getloc_fix *fix)
+{
+	pthread_mutex_lock(&session->last_lock);
+	session->last_fix = *fix;
+	session->last_known = 1;
+	getloc_latest_publish(session, fix);
+	getloc_track_update(session, fix);
+	pthread_mutex_unlock(&session->last_lock);
+}
+
+void getloc_fix_from_location(getloc_fix *fix, const WPS_Location *location)
+{
+	fix->version = GETLOC_FIX_VERSION;
+	fix->nap = location->nap;
+	fix->nsat = location->nsat;
+	fix->ncell = location->ncell;
+	fix->latitude = location->latitude;
+	fix->longitude = location->longitude;
+	fix->altitude = location->altitude;
+	fix->hpe = (float)location->hpe;
+	fix->speed = (float)location->speed;
+	fix->bearing = (float)location->bearing;
+	fix->age = (unsigned int)location->age;
+	fix->observed = getloc_now_ms() - (long long)location->age;
+	fix->timestamp = (unsigned int)location->timestamp;
+	fix->type = (unsigned char)location->type;
+	fix->source = GETLOC_SOURCE_WIFI;
+	fix->reserved[0] = 0;
+	fix->reserved[1] = 0;
+}
+
+void getloc_close(getloc_session *session)
+{
+	if (session == NULL)
+	{
+		return;
+	}
+
+	getloc_async_close(session);
+	getloc_fence_close(session);
+	getloc_stream_stop(session);
+	getloc_spool_close(session);
+	getloc_tiles_close(session);
+	getloc_latest_close(session);
+
+	// free all resources being used by the WPS API
+	if (session->loaded)
+	{
+		unsigned long long begin = getloc_stats_begin();
 		WPS_unload();
+		getloc_stats_end(GETLOC_CALL_UNLOAD, begin, WPS_OK);
+		pthread_cond_destroy(&session->resolve_done);
+		pthread_mutex_destroy(&session->breaker_lock);
+		pthread_mutex_destroy(&session->resolve_lock);
+		pthread_mutex_destroy(&session->last_lock);
+		pthread_cond_destroy(&session->async_wake);
+		pthread_mutex_destroy(&session->async_lock);
+		pthread_cond_destroy(&session->resolver_wake);
+		pthread_mutex_destroy(&session->spool_lock);
+		pthread_mutex_destroy(&session->sdk_lock);
+	}
 
-		/*
-		   * Units of coordinates are either in DD (Decimal Degrees) (or) in DMS (Degrees, Minutes and Seconds)
-		   * Latitude - North or South of the Equator. If North, then the DD value is positive, otherwise negative.
-		   * Longitude - East or West of the Prime Meridian. If East, then the DD value is positive, otherwise negative.
-		*/
+	if (open_session == session)
+	{
+		open_session = NULL;
+	}
+	free(session);
+}
 
-		// return the coordinates to the calling function
-		return coordinates;
+double *getLocation()
+{
+	static getloc_session *session = NULL;
+	static double coordinates[2];
+	getloc_fix fix;
+
+	if (session == NULL)
+	{
+		session = getloc_open(NULL);
+		if (session == NULL)
+		{
+			return NULL;
+		}
 	}
+
+	if (getloc_locate(session, &fix) != WPS_OK)
+	{
+		return NULL;
+	}
+	coordinates[0] = fix.longitude;
+	coordinates[1] = fix.latitude;
+
+	// return the coordinates { longitude, latitude } to the calling function
+	return coordinates;
 }
@@ -0,0 +1,382 @@
+#ifndef _GETLOCATION_H_
+#define _GETLOCATION_H_
+
+#include "./wpsapi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   * API key used when getloc_open() is called with a NULL key
+   * (found in my.skyhook.com under projects -> the project you're developing)
+   * override at build time with -DGETLOC_KEY=\"...\"
+*/
+#ifndef GETLOC_KEY
+#define GETLOC_KEY "YOUR_KEY_HERE"
+#endif
+
+/*
+   * A session owns the WPS API for as long as it is open.
+   * WPS_load() and WPS_set_key() run once in getloc_open(), WPS_unload() runs once in getloc_close(),
+   * and every getloc_locate() in between only pays for the scan itself.
+   *
+   * The WPS API is process-wide, so only one session can be open at a time.
+*/
+typedef struct getloc_session getloc_session;
+
+/*
+   * A single location fix, as a fixed-layout 64 byte record (one cache line) so it can be
+   * copied around by value, kept in rings, and read in place from Python through ctypes.
+   * Fields are only ever appended into the reserved bytes, and version is bumped when they are.
+*/
+#define GETLOC_FIX_VERSION 1
+
+enum
+{
+	GETLOC_SOURCE_WIFI = 0,      // WPS_location() or WPS_periodic_location()
+	GETLOC_SOURCE_OFFLINE = 1,   // resolved from the offline token spool
+	GETLOC_SOURCE_IP = 2,        // WPS_ip_location(), only latitude and longitude are known
+	GETLOC_SOURCE_LAST_KNOWN = 3 // the most recent fix, age says how old it is
+};
+
+typedef struct
+{
+	unsigned short version;     // GETLOC_FIX_VERSION
+	unsigned short nap;         // number of access points used
+	unsigned short nsat;        // number of satellites used
+	unsigned short ncell;       // number of cell towers used
+	double latitude;
+	double longitude;
+	double altitude;            // meters above mean sea level
+	float hpe;                  // horizontal positioning error in meters
+	float speed;                // km/h, negative if unknown
+	float bearing;              // degrees clockwise from north, negative if unknown
+	unsigned int age;           // milliseconds since the location was calculated, as reported by WPS
+	long long observed;         // unix time in milliseconds when the fix was observed
+	unsigned int timestamp;     // unix time in seconds on Skyhook's servers (certified locations only)
+	unsigned char type;         // WPS_LOCATION_TYPE_2D or WPS_LOCATION_TYPE_3D
+	unsigned char source;       // GETLOC_SOURCE_*
+	unsigned char reserved[2];
+} getloc_fix;
+
+_Static_assert(sizeof(getloc_fix) == 64, "getloc_fix must stay one cache line");
+
+// load the WPS API and set the key, returns NULL on failure
+getloc_session *getloc_open(const char *key);
+
+/*
+   * Determine the current location and write it into caller-owned storage.
+   * Nothing is allocated by this call, the WPS_Location is freed before returning.
+   * On failure the fix is left untouched and the WPS_ReturnCode is returned.
+*/
+WPS_ReturnCode getloc_locate(getloc_session *session, getloc_fix *fix);
+
+/*
+   * Streaming mode.
+   * getloc_stream_start() runs WPS_periodic_location() on a background thread, and every fix it reports
+   * is pushed into a bounded single-producer/single-consumer ring owned by the session.
+   * getloc_stream_drain() copies up to max fixes out of the ring without ever blocking on a scan.
+   * If the consumer falls behind, new fixes are dropped (and counted) rather than overwriting unread ones.
+   *
+   * While a stream is running, getloc_locate() returns WPS_NOT_APPLICABLE.
+   * getloc_stream_stop() waits for the next callback (at most one period) and returns the result
+   * of WPS_periodic_location(). A stream that ends on its own (WPS_periodic_location() failing, or the fatal
+   * breaker opening) is over as far as the session is concerned: getloc_locate() works again, the stream can be
+   * started again, and getloc_stream_stop() just returns the result.
+*/
+#ifndef GETLOC_STREAM_CAPACITY
+#define GETLOC_STREAM_CAPACITY 64 // must be a power of two
+#endif
+
+WPS_ReturnCode getloc_stream_start(getloc_session *session, unsigned long period);
+unsigned getloc_stream_drain(getloc_session *session, getloc_fix *fixes, unsigned max);
+unsigned long getloc_stream_dropped(getloc_session *session);
+WPS_ReturnCode getloc_stream_stop(getloc_session *session);
+
+/*
+   * Offline token spool.
+   * Once a spool is opened, any WPS_location() (or streamed fix) that fails with WPS_ERROR_SERVER_UNAVAILABLE
+   * or WPS_ERROR_TIMEOUT captures a WPS_offline_token() and appends it to the spool file at path.
+   * A background resolver turns the spooled tokens back into fixes with WPS_offline_location(), in bulk,
+   * as soon as a fix succeeds again (or every interval seconds otherwise). While a stream runs it owns the WPS API,
+   * so tokens captured from it are only resolved once it stops.
+   * Resolved fixes carry the time the token was captured and are drained with getloc_spool_drain().
+   *
+   * The key encrypts the tokens, so it must stay the same across restarts for the spool to be redeemable.
+   * Tokens are only valid for 90 days, older ones are discarded by the resolver.
+*/
+#ifndef GETLOC_SPOOL_KEY_MAX
+#define GETLOC_SPOOL_KEY_MAX 64
+#endif
+
+WPS_ReturnCode getloc_spool_open(getloc_session *session, const char *path, const unsigned char *key, unsigned key_length, unsigned interval);
+unsigned getloc_spool_drain(getloc_session *session, getloc_fix *fixes, unsigned max);
+unsigned long getloc_spool_pending(getloc_session *session);
+
+/*
+   * Tile cache.
+   * getloc_tiles_open() points WPS_set_tiling() at dirpath with the given byte budgets, so that fixes
+   * inside downloaded tiles are computed locally instead of on the server.
+   * Tiles are typically less than GETLOC_TILE_SIZE bytes; if prefetch_tiles is nonzero, one fix is taken
+   * right away with a per-session budget of prefetch_tiles tiles so the deployment region around the unit
+   * is on disk before the first real fix (the SDK picks the tiles, it has no call to fetch an explicit area).
+   *
+   * The tiling callback counts every tile the SDK downloads and, from the gaps in tileNumber,
+   * every tile it skipped because it was already cached.
+   * A fix counts as a hit when no tile had to be downloaded while it was computed.
+*/
+#define GETLOC_TILE_SIZE (50 * 1024)
+
+typedef struct
+{
+	unsigned long downloads;
+	unsigned long skipped;
+	unsigned long hits;
+	unsigned long misses;
+} getloc_tile_stats;
+
+WPS_ReturnCode getloc_tiles_open(getloc_session *session, const char *dirpath, unsigned max_per_session, unsigned max_total, unsigned prefetch_tiles);
+void getloc_tiles_stats(getloc_session *session, getloc_tile_stats *stats);
+
+/*
+   * Geofences.
+   * getloc_fence_add() registers a site with WPS_geofence_set() as a pair of WPS_GEOFENCE_ENTER and
+   * WPS_GEOFENCE_LEAVE fences, and returns its id (or -1).
+   * The WPS API only evaluates fences while WPS_periodic_location() runs, so a stream must be started
+   * for events to be delivered; period is the Wi-Fi period to use while nothing is about to change.
+   *
+   * Every transition is queued, and the eventfd returned by getloc_fence_fd() becomes readable,
+   * so a consumer can poll() it and only wake on transitions; getloc_fence_drain() empties the queue.
+   * A callback can also be installed (before the first fence is added), it runs on the WPS thread and must not block.
+   * getloc_fence_clear() cancels every fence with WPS_geofence_cancel_all().
+*/
+#ifndef GETLOC_FENCE_MAX
+#define GETLOC_FENCE_MAX 8
+#endif
+#define GETLOC_FENCE_QUEUE 32 // must be a power of two
+
+typedef struct
+{
+	int fence;
+	int entered; // 1 when the unit entered the fence, 0 when it left
+	getloc_fix fix;
+} getloc_fence_event;
+
+typedef void (*getloc_fence_callback)(void *arg, const getloc_fence_event *event);
+
+int getloc_fence_add(getloc_session *session, double latitude, double longitude, unsigned radius, unsigned long period);
+int getloc_fence_fd(getloc_session *session);
+unsigned getloc_fence_drain(getloc_session *session, getloc_fence_event *events, unsigned max);
+void getloc_fence_set_callback(getloc_session *session, getloc_fence_callback callback, void *arg);
+WPS_ReturnCode getloc_fence_clear(getloc_session *session);
+
+/*
+   * Asynchronous requests.
+   * getloc_async_submit() queues a getloc_locate() for a worker thread and returns its request id
+   * right away (or 0 if GETLOC_ASYNC_QUEUE requests are already outstanding).
+   * When the request completes, its callback runs on the worker thread if one was given, otherwise the
+   * result is queued and the eventfd from getloc_async_fd() becomes readable, so the request can be
+   * driven from a poll() loop next to other work; getloc_async_drain() collects the results.
+*/
+#define GETLOC_ASYNC_QUEUE 16 // must be a power of two
+
+typedef struct
+{
+	unsigned long id;
+	WPS_ReturnCode rc;
+	getloc_fix fix; // only valid if rc is WPS_OK
+} getloc_async_result;
+
+typedef void (*getloc_async_callback)(void *arg, const getloc_async_result *result);
+
+unsigned long getloc_async_submit(getloc_session *session, getloc_async_callback callback, void *arg);
+int getloc_async_fd(getloc_session *session);
+unsigned getloc_async_drain(getloc_session *session, getloc_async_result *results, unsigned max);
+
+/*
+   * Tiered resolver.
+   * getloc_resolve() gives an answer within deadline milliseconds: it starts a Wi-Fi fix on the async worker,
+   * falls back to WPS_ip_location() if that fails while there is still time left, and once the deadline
+   * passes returns the last known fix with its age brought up to date.
+   * fix->source says which tier produced the answer; WPS_ERROR_TIMEOUT means nothing was known yet.
+   *
+   * A Wi-Fi fix that misses the deadline keeps running, its result becomes the new last known fix
+   * and the next call waits on it instead of starting another scan.
+   * The WPS API takes one call at a time, so the tiers run one after the other rather than in parallel.
+*/
+WPS_ReturnCode getloc_resolve(getloc_session *session, unsigned long deadline, getloc_fix *fix);
+
+/*
+   * Smoothed track.
+   * Every fresh fix with a known hpe (Wi-Fi, streamed or not) feeds a constant-velocity Kalman filter
+   * in a local east/north plane, with the fix's hpe as the standard deviation of its position on each axis
+   * and acceleration as the standard deviation of the unmodelled acceleration, in m/s^2.
+   * A fix whose Mahalanobis distance from the predicted position exceeds gate is rejected as an outlier,
+   * unless GETLOC_TRACK_RESET fixes in a row are, then the unit has really moved and the track restarts from there.
+   * getloc_track_get() returns 0 until the first fix.
+*/
+#define GETLOC_TRACK_RESET 3
+
+typedef struct
+{
+	double latitude;
+	double longitude;
+	double north_velocity; // m/s
+	double east_velocity;  // m/s
+	double covariance[3];  // position covariance in m^2: north/north, north/east, east/east
+	long long observed;    // unix time in milliseconds of the latest accepted fix
+	unsigned long accepted;
+	unsigned long rejected;
+} getloc_track_estimate;
+
+// defaults: acceleration 0.5 m/s^2, gate 3 (99% of fixes consistent with the track are accepted)
+WPS_ReturnCode getloc_track_config(getloc_session *session, double acceleration, double gate);
+int getloc_track_get(getloc_session *session, getloc_track_estimate *estimate);
+
+/*
+   * Location daemon.
+   * getlocd owns the one WPS session on the unit, streams fixes, and answers every request on a
+   * SOCK_SEQPACKET Unix socket with the latest fix (age brought up to date, hpe as its quality),
+   * so any number of local processes can be geotagged without a scan of their own.
+   * A request is any single byte; a client may keep its connection and ask again, or connect per request.
+   * getloc_remote_locate() does the latter and needs no session, rc is WPS_ERROR_LOCATION_CANNOT_BE_DETERMINED
+   * until getlocd has a fix, and WPS_ERROR_SERVER_UNAVAILABLE if getlocd isn't running or doesn't answer
+   * within GETLOCD_TIMEOUT_MS. getlocd starts its stream again, backing off up to ten minutes, whenever it ends on its own.
+*/
+#define GETLOCD_SOCKET "/tmp/getlocd.sock"
+#define GETLOCD_TIMEOUT_MS 2000
+
+typedef struct
+{
+	WPS_ReturnCode rc;
+	unsigned int reserved;
+	getloc_fix fix;
+} getloc_remote_reply;
+
+WPS_ReturnCode getloc_remote_locate(const char *path, getloc_fix *fix);
+
+/*
+   * Latest fix in shared memory.
+   * After getloc_publish(), every fresh fix the session gets is also written into a seqlock slot in the
+   * POSIX shared memory object name (GETLOC_LATEST_NAME if NULL). Any process on the unit can read it with
+   * getloc_latest(), which takes no lock and makes no system call once the object is mapped, so samplers can
+   * geotag every reading. A read retries while a write is in progress, which only ever takes a 64 byte copy.
+   * Only one session on the unit can publish to a name: getloc_publish() fails with WPS_ERROR while another
+   * holds it, e.g. skyhook.py's while getlocd runs.
+   * getloc_latest() maps the first name it is called with for the life of the process, and returns
+   * WPS_ERROR_SERVER_UNAVAILABLE if nothing publishes there, WPS_ERROR_LOCATION_CANNOT_BE_DETERMINED before the first fix.
+*/
+#define GETLOC_LATEST_NAME "/getloc_latest"
+
+WPS_ReturnCode getloc_publish(getloc_session *session, const char *name);
+WPS_ReturnCode getloc_latest(const char *name, getloc_fix *fix);
+
+/*
+   * Circuit breakers.
+   * Failed fixes are classified by return code, and each class has its own breaker:
+   *     transient   - WPS_ERROR_TIMEOUT, WPS_ERROR_SERVER_UNAVAILABLE
+   *     environment - WPS_ERROR_NO_WIFI_IN_RANGE, WPS_ERROR_WIFI_NOT_AVAILABLE, WPS_ERROR_LOCATION_CANNOT_BE_DETERMINED
+   *     fatal       - WPS_ERROR_UNAUTHORIZED, WPS_ERROR_PROXY_UNAUTHORIZED, WPS_ERROR_LOCATION_SETTING_DISABLED, WPS_ERROR_LOCATION_NOT_PERMITTED
+   * After threshold consecutive failures of a class its breaker opens, and getloc_locate() (and everything built on it)
+   * fails straight away with the last code of that class, without calling the WPS API.
+   * Once the backoff has passed the breaker is half-open and lets a single call through as a probe:
+   * if the probe succeeds every breaker closes, if it fails with the same class the breaker opens again for twice as long.
+   * Backoffs start at base, double up to max, and are jittered over their upper half.
+   * IP location ignores the environment breaker, it doesn't need Wi-Fi.
+*/
+typedef enum
+{
+	GETLOC_CLASS_TRANSIENT,
+	GETLOC_CLASS_ENVIRONMENT,
+	GETLOC_CLASS_FATAL,
+	GETLOC_CLASSES,
+	GETLOC_CLASS_NONE = -1 // WPS_OK, and codes no breaker reacts to
+} getloc_class;
+
+typedef enum
+{
+	GETLOC_BREAKER_CLOSED,
+	GETLOC_BREAKER_OPEN,
+	GETLOC_BREAKER_HALF_OPEN
+} getloc_breaker_state;
+
+typedef struct
+{
+	getloc_breaker_state state;
+	unsigned failures;      // consecutive failures of this class
+	unsigned opens;         // times opened since it last closed
+	unsigned long retry_in; // milliseconds until the next probe, 0 unless open
+	unsigned long rejected; // calls failed without reaching the WPS API
+	WPS_ReturnCode last;    // the latest failure of this class
+} getloc_breaker_info;
+
+getloc_class getloc_classify(WPS_ReturnCode rc);
+
+// base and max in milliseconds, defaults: transient 3 failures, 2 s to 5 min; environment 3 failures, 10 s to 10 min; fatal 1 failure, 10 min to 6 h
+WPS_ReturnCode getloc_breaker_config(getloc_session *session, getloc_class cls, unsigned threshold, unsigned long base, unsigned long max);
+void getloc_breaker_status(getloc_session *session, getloc_class cls, getloc_breaker_info *info);
+
+/*
+   * WPS call statistics.
+   * Every WPS call libgetloc makes is timed on CLOCK_MONOTONIC and recorded, with relaxed atomics only,
+   * into a log-linear latency histogram (GETLOC_HIST_SUB buckets per power of two nanoseconds)
+   * and a counter per WPS_ReturnCode.
+   * GETLOC_CALL_PERIODIC_FIX records each WPS_periodic_location() callback, timed from the previous one.
+   * The statistics are process-wide, like the WPS API, and survive sessions.
+*/
+typedef enum
+{
+	GETLOC_CALL_LOAD,
+	GETLOC_CALL_SET_KEY,
+	GETLOC_CALL_LOCATION,
+	GETLOC_CALL_IP_LOCATION,
+	GETLOC_CALL_PERIODIC_LOCATION,
+	GETLOC_CALL_PERIODIC_FIX,
+	GETLOC_CALL_OFFLINE_TOKEN,
+	GETLOC_CALL_OFFLINE_LOCATION,
+	GETLOC_CALL_SET_TILING,
+	GETLOC_CALL_GEOFENCE_SET,
+	GETLOC_CALL_GEOFENCE_CANCEL,
+	GETLOC_CALL_UNLOAD,
+	GETLOC_CALLS
+} getloc_call;
+
+#define GETLOC_HIST_SUB_BITS 3
+#define GETLOC_HIST_SUB (1 << GETLOC_HIST_SUB_BITS)
+#define GETLOC_HIST_BUCKETS (40 * GETLOC_HIST_SUB) // up to 2^42 ns, a bit over an hour
+#define GETLOC_CODES 20 // WPS_OK..WPS_ERROR_LOCATION_NOT_PERMITTED, then WPS_NOMEM, WPS_ERROR, anything else
+
+typedef struct
+{
+	unsigned long long count;
+	unsigned long long sum; // nanoseconds
+	unsigned long long max; // nanoseconds
+	unsigned long long codes[GETLOC_CODES];
+	unsigned long long buckets[GETLOC_HIST_BUCKETS];
+} getloc_call_stats;
+
+const char *getloc_call_name(getloc_call call);
+void getloc_stats_snapshot(getloc_call call, getloc_call_stats *stats);
+
+// index into getloc_call_stats.codes for a WPS_ReturnCode
+unsigned getloc_stats_code_index(WPS_ReturnCode rc);
+
+// latency in nanoseconds at quantile q (0..1) of a snapshot, to within the bucket width
+unsigned long long getloc_stats_quantile(const getloc_call_stats *stats, double q);
+
+// unload the WPS API and release the session
+void getloc_close(getloc_session *session);
+
+/*
+   * Legacy entry point kept for existing callers.
+   * Uses a process-wide session that is opened on first use, and returns a pointer to static storage
+   * holding { longitude, latitude } (valid until the next call), or NULL if no location could be determined.
+*/
+double *getLocation();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _GETLOCATION_H_
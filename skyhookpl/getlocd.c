@@ -0,0 +1,231 @@
+/*
+   * getlocd - owns the WPS session and serves the latest fix to local processes over a Unix socket
+   * and the GETLOC_LATEST_NAME shared memory slot, see "Location daemon" in getlocation.h
+   *
+   *     getlocd [-s socket path] [-p period ms] [-t tile directory]
+*/
+#include "./getlocation.h"
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_CLIENTS 64
+#define DRAIN_MS 250 // how often the stream is drained when no client is asking
+#define RESTART_MIN_MS 1000 // first wait before restarting a stream that ended on its own
+#define RESTART_MAX_MS (10 * 60 * 1000) // the wait doubles up to this while the stream keeps ending
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int signal)
+{
+	(void)signal;
+	stop = 1;
+}
+
+static long long now_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int listen_on(const char *path)
+{
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path))
+	{
+		fprintf(stderr, "*** getlocd: socket path too long!\n");
+		return -1;
+	}
+	strcpy(address.sun_path, path);
+
+	int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+	{
+		perror("*** getlocd: socket");
+		return -1;
+	}
+
+	// a socket left behind by a previous run would make bind() fail
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 16) != 0)
+	{
+		perror("*** getlocd: bind");
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = GETLOCD_SOCKET;
+	unsigned long period = 60 * 1000;
+	const char *tiles = NULL;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "s:p:t:")) != -1)
+	{
+		switch (opt)
+		{
+		case 's':
+			path = optarg;
+			break;
+		case 'p':
+			period = strtoul(optarg, NULL, 10);
+			break;
+		case 't':
+			tiles = optarg;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-s socket path] [-p period ms] [-t tile directory]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = on_signal;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	getloc_session *session = getloc_open(NULL);
+	if (session == NULL)
+	{
+		return 1;
+	}
+	if (tiles != NULL && getloc_tiles_open(session, tiles, 450 * 1024, 2 * 1024 * 1024, 9) != WPS_OK)
+	{
+		fprintf(stderr, "*** getlocd: no tile cache, every fix will go to the server\n");
+	}
+	if (getloc_publish(session, NULL) != WPS_OK)
+	{
+		fprintf(stderr, "*** getlocd: the latest fix is only served over the socket\n");
+	}
+	if (getloc_stream_start(session, period) != WPS_OK)
+	{
+		getloc_close(session);
+		return 1;
+	}
+
+	int listener = listen_on(path);
+	if (listener < 0)
+	{
+		getloc_stream_stop(session);
+		getloc_close(session);
+		return 1;
+	}
+
+	// pfds[0] is the listening socket, the rest are clients
+	struct pollfd pfds[1 + MAX_CLIENTS];
+	unsigned nclients = 0;
+	pfds[0].fd = listener;
+	pfds[0].events = POLLIN;
+
+	getloc_fix fixes[GETLOC_STREAM_CAPACITY];
+	getloc_remote_reply reply;
+	memset(&reply, 0, sizeof(reply));
+	reply.rc = WPS_ERROR_LOCATION_CANNOT_BE_DETERMINED;
+
+	// a stream that ends on its own (the fatal breaker opening) would otherwise leave the daemon
+	// serving its last fix forever, so it is started again, backing off while it keeps ending
+	unsigned long backoff = RESTART_MIN_MS;
+	long long restart_at = 0;
+
+	while (!stop)
+	{
+		if (poll(pfds, 1 + nclients, DRAIN_MS) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			perror("*** getlocd: poll");
+			break;
+		}
+
+		unsigned n = getloc_stream_drain(session, fixes, GETLOC_STREAM_CAPACITY);
+		if (n > 0)
+		{
+			reply.rc = WPS_OK;
+			reply.fix = fixes[n - 1];
+			backoff = RESTART_MIN_MS;
+		}
+
+		// getloc_stream_start() is WPS_NOT_APPLICABLE while the stream still runs
+		long long now = now_ms();
+		if (now >= restart_at)
+		{
+			WPS_ReturnCode rc = getloc_stream_start(session, period);
+			if (rc != WPS_NOT_APPLICABLE)
+			{
+				fprintf(stderr, "*** getlocd: the stream had ended, %s (next try in %lu ms)\n", rc == WPS_OK ? "restarted it" : "could not restart it", backoff);
+				restart_at = now + backoff;
+				backoff = backoff * 2 < RESTART_MAX_MS ? backoff * 2 : RESTART_MAX_MS;
+			}
+		}
+
+		// answer before accepting, so the slots of clients that hung up are free again
+		for (unsigned i = 1; i <= nclients; i++)
+		{
+			if (pfds[i].revents == 0)
+			{
+				continue;
+			}
+
+			char request;
+			if (!(pfds[i].revents & POLLIN) || recv(pfds[i].fd, &request, 1, MSG_DONTWAIT) <= 0)
+			{
+				close(pfds[i].fd);
+				pfds[i--] = pfds[nclients--];
+				continue;
+			}
+
+			getloc_remote_reply answer = reply;
+			if (answer.rc == WPS_OK)
+			{
+				long long age = now_ms() - answer.fix.observed;
+				answer.fix.age = age > 0 ? (unsigned int)age : 0;
+			}
+			send(pfds[i].fd, &answer, sizeof(answer), MSG_DONTWAIT | MSG_NOSIGNAL);
+		}
+
+		if (pfds[0].revents & POLLIN)
+		{
+			int client;
+			while ((client = accept(listener, NULL, NULL)) >= 0)
+			{
+				if (nclients == MAX_CLIENTS)
+				{
+					fprintf(stderr, "*** getlocd: too many clients!\n");
+					close(client);
+					continue;
+				}
+				nclients++;
+				pfds[nclients].fd = client;
+				pfds[nclients].events = POLLIN;
+				pfds[nclients].revents = 0;
+			}
+		}
+	}
+
+	for (unsigned i = 1; i <= nclients; i++)
+	{
+		close(pfds[i].fd);
+	}
+	close(listener);
+	unlink(path);
+
+	getloc_stream_stop(session);
+	getloc_close(session);
+	return 0;
+}
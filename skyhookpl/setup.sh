@@ -6,4 +6,7 @@
 
 # compile and generate libgetloc.so file that skyhook.py will use to fetch coordinates
 
-gcc -fPIC -shared -o libgetloc.so getlocation.c -lm libwpsapi.so
+gcc -fPIC -shared -o libgetloc.so getlocation.c getloc_*.c -lm -lpthread -lrt libwpsapi.so
+
+# getlocd serves the latest fix to every other process on the unit over a Unix socket (see getlocation.h)
+gcc -o getlocd getlocd.c libgetloc.so libwpsapi.so -lpthread
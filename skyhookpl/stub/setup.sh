@@ -0,0 +1,6 @@
+# build a stand-in libwpsapi.so from wpsapi_stub.c, so libgetloc can be run without Skyhook's library or a key
+# its latency, errors and callback timing are scripted through WPS_STUB_* environment variables (see wpsapi_stub.c)
+
+cd "$(dirname "$0")"
+
+gcc -O2 -fPIC -shared -Wl,-soname,libwpsapi.so -o libwpsapi.so wpsapi_stub.c -lm -lpthread
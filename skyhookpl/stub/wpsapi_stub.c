@@ -0,0 +1,697 @@
+/*
+   * Stand-in for Skyhook's libwpsapi.so, implementing the WPS_* calls from ../wpsapi.h
+   * so libgetloc can be run and measured on any machine, without a key or a Wi-Fi scan.
+   *
+   * Behaviour is scripted through environment variables, read by the first WPS_load():
+   *
+   * WPS_STUB_LATENCY     latency of WPS_location(), WPS_ip_location() and WPS_offline_location() in ms
+   * WPS_STUB_LOAD        latency of WPS_load() in ms
+   * WPS_STUB_PERIODIC    time between WPS_periodic_location() callbacks in ms (defaults to the requested period)
+   *
+   *     each one a distribution: "fixed:MS", "uniform:LO:HI" or "lognormal:MEDIAN:SIGMA"
+   *
+   * WPS_STUB_ERRORS      comma separated WPS_ReturnCode sequence returned by successive location requests,
+   *                      repeated when exhausted (e.g. "0,0,5,10,3"), defaults to always WPS_OK
+   * WPS_STUB_IP_ERRORS   the same for WPS_ip_location()
+   * WPS_STUB_POSITION    "LAT,LON" reported by every fix, defaults to Hyderabad
+   * WPS_STUB_WALK        meters the position moves between successive fixes, in a random direction
+   * WPS_STUB_HPE         horizontal positioning error reported, in meters
+   * WPS_STUB_TILES       tiles "downloaded" through the tiling callback on the first fix after WPS_set_tiling()
+   * WPS_STUB_SEED        seed for the random number generator
+*/
+#include "../wpsapi.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_ERRORS 64
+#define MAX_FENCES 32
+#define EARTH_RADIUS_M 6371000.0
+
+typedef struct
+{
+	enum { FIXED, UNIFORM, LOGNORMAL } kind;
+	double a;
+	double b;
+} distribution;
+
+typedef struct
+{
+	WPS_ReturnCode codes[MAX_ERRORS];
+	unsigned count;
+	unsigned next;
+} error_script;
+
+static struct
+{
+	pthread_mutex_t lock;
+	int configured;
+	int loaded;
+	uint64_t rng;
+
+	distribution latency;
+	distribution load;
+	distribution periodic;
+	int periodic_set;
+	error_script errors;
+	error_script ip_errors;
+
+	double latitude;
+	double longitude;
+	double walk;
+	double hpe;
+
+	unsigned tiles;
+	int tiles_pending;
+	WPS_TilingCallback tiling_callback;
+	void *tiling_arg;
+
+	struct
+	{
+		int used;
+		WPS_GeoFence geofence;
+		WPS_GeoFenceCallback callback;
+		void *arg;
+		int inside; // -1 until the first fix
+	} fences[MAX_FENCES];
+} stub = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static double random_unit()
+{
+	// xorshift64*, plenty for scripting latencies
+	stub.rng ^= stub.rng >> 12;
+	stub.rng ^= stub.rng << 25;
+	stub.rng ^= stub.rng >> 27;
+	return (double)((stub.rng * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static void parse_distribution(const char *name, distribution *d, double fallback)
+{
+	d->kind = FIXED;
+	d->a = fallback;
+	d->b = 0;
+
+	const char *value = getenv(name);
+	if (value == NULL)
+	{
+		return;
+	}
+
+	double a, b;
+	if (sscanf(value, "fixed:%lf", &a) == 1)
+	{
+		d->a = a;
+	}
+	else if (sscanf(value, "uniform:%lf:%lf", &a, &b) == 2)
+	{
+		d->kind = UNIFORM;
+		d->a = a;
+		d->b = b;
+	}
+	else if (sscanf(value, "lognormal:%lf:%lf", &a, &b) == 2)
+	{
+		d->kind = LOGNORMAL;
+		d->a = a;
+		d->b = b;
+	}
+	else
+	{
+		fprintf(stderr, "*** wpsapi stub: can't parse %s=%s, using fixed:%g\n", name, value, fallback);
+	}
+}
+
+// called with stub.lock held
+static double sample(const distribution *d)
+{
+	switch (d->kind)
+	{
+	case UNIFORM:
+		return d->a + (d->b - d->a) * random_unit();
+	case LOGNORMAL:
+	{
+		// Box-Muller
+		double u = random_unit();
+		double v = random_unit();
+		double z = sqrt(-2.0 * log(u > 0 ? u : 1e-300)) * cos(2.0 * M_PI * v);
+		return d->a * exp(d->b * z);
+	}
+	default:
+		return d->a;
+	}
+}
+
+static void parse_errors(const char *name, error_script *script)
+{
+	script->count = 0;
+	script->next = 0;
+
+	const char *value = getenv(name);
+	while (value != NULL && *value != '\0' && script->count < MAX_ERRORS)
+	{
+		char *end;
+		long code = strtol(value, &end, 10);
+		if (end == value)
+		{
+			break;
+		}
+		script->codes[script->count++] = (WPS_ReturnCode)code;
+		value = *end == ',' ? end + 1 : end;
+	}
+}
+
+// called with stub.lock held
+static WPS_ReturnCode next_code(error_script *script)
+{
+	if (script->count == 0)
+	{
+		return WPS_OK;
+	}
+	WPS_ReturnCode rc = script->codes[script->next];
+	script->next = (script->next + 1) % script->count;
+	return rc;
+}
+
+static void sleep_ms(double ms)
+{
+	if (ms <= 0)
+	{
+		return;
+	}
+	struct timespec ts;
+	ts.tv_sec = (time_t)(ms / 1000);
+	ts.tv_nsec = (long)((ms - ts.tv_sec * 1000.0) * 1e6);
+	while (nanosleep(&ts, &ts) != 0)
+	{
+	}
+}
+
+static double latency()
+{
+	pthread_mutex_lock(&stub.lock);
+	double ms = sample(&stub.latency);
+	pthread_mutex_unlock(&stub.lock);
+	return ms;
+}
+
+static double distance_m(double lat1, double lon1, double lat2, double lon2)
+{
+	double p1 = lat1 * M_PI / 180, p2 = lat2 * M_PI / 180;
+	double dp = p2 - p1, dl = (lon2 - lon1) * M_PI / 180;
+	double h = sin(dp / 2) * sin(dp / 2) + cos(p1) * cos(p2) * sin(dl / 2) * sin(dl / 2);
+	return 2 * EARTH_RADIUS_M * asin(sqrt(h));
+}
+
+// the next position along the scripted walk, called with stub.lock held
+static WPS_Location *make_location()
+{
+	if (stub.walk > 0)
+	{
+		double heading = 2 * M_PI * random_unit();
+		stub.latitude += stub.walk * cos(heading) / EARTH_RADIUS_M * 180 / M_PI;
+		stub.longitude += stub.walk * sin(heading) / (EARTH_RADIUS_M * cos(stub.latitude * M_PI / 180)) * 180 / M_PI;
+	}
+
+	WPS_Location *location = calloc(1, sizeof(WPS_Location));
+	if (location == NULL)
+	{
+		return NULL;
+	}
+	location->latitude = stub.latitude;
+	location->longitude = stub.longitude;
+	location->hpe = stub.hpe;
+	location->nap = 7;
+	location->speed = -1;
+	location->bearing = -1;
+	location->altitude = 540;
+	location->timestamp = (unsigned long)time(NULL);
+	location->type = WPS_LOCATION_TYPE_2D;
+	return location;
+}
+
+// run the tiling callback for the tiles a first fix would pull in, called without stub.lock
+static void download_tiles()
+{
+	pthread_mutex_lock(&stub.lock);
+	int pending = stub.tiles_pending;
+	unsigned total = stub.tiles;
+	WPS_TilingCallback callback = stub.tiling_callback;
+	void *arg = stub.tiling_arg;
+	stub.tiles_pending = 0;
+	pthread_mutex_unlock(&stub.lock);
+
+	if (!pending || callback == NULL)
+	{
+		return;
+	}
+	for (unsigned i = 0; i < total; i++)
+	{
+		if (callback(arg, i, total) == WPS_STOP)
+		{
+			break;
+		}
+	}
+}
+
+static WPS_ReturnCode locate(error_script *script, WPS_Location **location)
+{
+	sleep_ms(latency());
+
+	pthread_mutex_lock(&stub.lock);
+	WPS_ReturnCode rc = stub.loaded ? next_code(script) : WPS_ERROR;
+	if (rc == WPS_OK)
+	{
+		*location = make_location();
+		if (*location == NULL)
+		{
+			rc = WPS_NOMEM;
+		}
+	}
+	pthread_mutex_unlock(&stub.lock);
+
+	if (rc == WPS_OK)
+	{
+		download_tiles();
+	}
+	return rc;
+}
+
+WPSAPI_EXPORT const char *WPSAPI_CALL WPS_version()
+{
+	return "stub";
+}
+
+// read the script from the environment, called with stub.lock held
+static void configure()
+{
+	const char *seed = getenv("WPS_STUB_SEED");
+	stub.rng = seed != NULL ? strtoull(seed, NULL, 10) | 1 : 0x9e3779b97f4a7c15ULL;
+
+	parse_distribution("WPS_STUB_LATENCY", &stub.latency, 0);
+	parse_distribution("WPS_STUB_LOAD", &stub.load, 0);
+	stub.periodic_set = getenv("WPS_STUB_PERIODIC") != NULL;
+	parse_distribution("WPS_STUB_PERIODIC", &stub.periodic, 0);
+	parse_errors("WPS_STUB_ERRORS", &stub.errors);
+	parse_errors("WPS_STUB_IP_ERRORS", &stub.ip_errors);
+
+	stub.latitude = 17.385;
+	stub.longitude = 78.4867;
+	const char *position = getenv("WPS_STUB_POSITION");
+	if (position != NULL)
+	{
+		sscanf(position, "%lf,%lf", &stub.latitude, &stub.longitude);
+	}
+	stub.walk = getenv("WPS_STUB_WALK") != NULL ? atof(getenv("WPS_STUB_WALK")) : 0;
+	stub.hpe = getenv("WPS_STUB_HPE") != NULL ? atof(getenv("WPS_STUB_HPE")) : 25;
+	stub.tiles = getenv("WPS_STUB_TILES") != NULL ? (unsigned)atoi(getenv("WPS_STUB_TILES")) : 9;
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_load()
+{
+	pthread_mutex_lock(&stub.lock);
+
+	// the script is only read once, so a caller that loads and unloads repeatedly walks through it like any other
+	if (!stub.configured)
+	{
+		configure();
+		stub.configured = 1;
+	}
+
+	double ms = sample(&stub.load);
+	stub.loaded = 1;
+	pthread_mutex_unlock(&stub.lock);
+
+	sleep_ms(ms);
+	return WPS_OK;
+}
+
+WPSAPI_EXPORT void WPSAPI_CALL WPS_unload()
+{
+	pthread_mutex_lock(&stub.lock);
+	stub.loaded = 0;
+	stub.tiling_callback = NULL;
+	memset(stub.fences, 0, sizeof(stub.fences));
+	pthread_mutex_unlock(&stub.lock);
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_set_key(const char *key)
+{
+	return key != NULL ? WPS_OK : WPS_ERROR_UNAUTHORIZED;
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_set_auth_token(const char *token)
+{
+	return token != NULL ? WPS_OK : WPS_ERROR_UNAUTHORIZED;
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_set_registration_user(const WPS_SimpleAuthentication *authentication)
+{
+	return authentication != NULL ? WPS_OK : WPS_ERROR_UNAUTHORIZED;
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_register_user(const WPS_SimpleAuthentication *authentication, const WPS_SimpleAuthentication *new_authentication)
+{
+	(void)new_authentication;
+	return authentication != NULL ? WPS_OK : WPS_ERROR_UNAUTHORIZED;
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_location(const WPS_SimpleAuthentication *authentication, WPS_StreetAddressLookup street_address_lookup, WPS_Location **location)
+{
+	(void)authentication;
+	(void)street_address_lookup;
+	return locate(&stub.errors, location);
+}
+
+// evaluate every geofence against a new fix, called without stub.lock
+static WPS_Continuation check_fences(const WPS_Location *location)
+{
+	WPS_Continuation continuation = WPS_CONTINUE;
+
+	for (int i = 0; i < MAX_FENCES; i++)
+	{
+		pthread_mutex_lock(&stub.lock);
+		if (!stub.fences[i].used)
+		{
+			pthread_mutex_unlock(&stub.lock);
+			continue;
+		}
+		WPS_GeoFence geofence = stub.fences[i].geofence;
+		WPS_GeoFenceCallback callback = stub.fences[i].callback;
+		void *arg = stub.fences[i].arg;
+		int inside = distance_m(location->latitude, location->longitude, geofence.latitude, geofence.longitude) <= geofence.radius;
+		int was_inside = stub.fences[i].inside;
+		stub.fences[i].inside = inside;
+		pthread_mutex_unlock(&stub.lock);
+
+		// like the real API, a fence fires once per transition of its own kind
+		int fire = geofence.type == WPS_GEOFENCE_ENTER ? inside && was_inside != 1 : !inside && was_inside != 0;
+		if (fire && callback(arg, &geofence, location, NULL) == WPS_STOP)
+		{
+			continuation = WPS_STOP;
+		}
+	}
+	return continuation;
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_periodic_location(const WPS_SimpleAuthentication *authentication, WPS_StreetAddressLookup street_address_lookup, unsigned long period, unsigned iterations, WPS_LocationCallback callback, void *arg)
+{
+	(void)authentication;
+	(void)street_address_lookup;
+
+	if (period == 0)
+	{
+		return WPS_ERROR;
+	}
+
+	for (unsigned i = 0; iterations == 0 || i < iterations; i++)
+	{
+		pthread_mutex_lock(&stub.lock);
+		double ms = stub.periodic_set ? sample(&stub.periodic) : (double)period;
+		pthread_mutex_unlock(&stub.lock);
+		sleep_ms(ms);
+
+		pthread_mutex_lock(&stub.lock);
+		if (!stub.loaded)
+		{
+			pthread_mutex_unlock(&stub.lock);
+			return WPS_ERROR;
+		}
+		WPS_Location *location = NULL;
+		WPS_ReturnCode rc = next_code(&stub.errors);
+		if (rc == WPS_OK)
+		{
+			location = make_location();
+		}
+		pthread_mutex_unlock(&stub.lock);
+
+		WPS_Continuation continuation = WPS_CONTINUE;
+		if (location != NULL)
+		{
+			download_tiles();
+			continuation = check_fences(location);
+		}
+		if (callback != NULL && callback(arg, location != NULL ? WPS_OK : rc, location, NULL) == WPS_STOP)
+		{
+			continuation = WPS_STOP;
+		}
+		free(location);
+
+		if (continuation == WPS_STOP)
+		{
+			break;
+		}
+	}
+	return WPS_OK;
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_certified_location(const WPS_SimpleAuthentication *authentication, WPS_StreetAddressLookup street_address_lookup, WPS_CertifiedLocationCallback callback, void *arg)
+{
+	(void)authentication;
+	(void)street_address_lookup;
+
+	WPS_Location *location = NULL;
+	WPS_ReturnCode rc = locate(&stub.errors, &location);
+	const WPS_Location *locations[1] = { location };
+	callback(arg, rc, rc == WPS_OK ? locations : NULL, rc == WPS_OK ? 1 : 0, NULL);
+	free(location);
+	return rc;
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_signed_certified_location(const WPS_SimpleAuthentication *authentication, WPS_StreetAddressLookup street_address_lookup, const unsigned char *salt, unsigned saltLen, WPS_CertifiedLocationCallback callback, void *arg)
+{
+	(void)salt;
+	(void)saltLen;
+	return WPS_certified_location(authentication, street_address_lookup, callback, arg);
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_ip_location(const WPS_SimpleAuthentication *authentication, WPS_StreetAddressLookup street_address_lookup, WPS_IPLocation **location)
+{
+	(void)authentication;
+	(void)street_address_lookup;
+
+	sleep_ms(latency());
+
+	pthread_mutex_lock(&stub.lock);
+	WPS_ReturnCode rc = stub.loaded ? next_code(&stub.ip_errors) : WPS_ERROR;
+	if (rc == WPS_OK)
+	{
+		*location = calloc(1, sizeof(WPS_IPLocation));
+		if (*location == NULL)
+		{
+			rc = WPS_NOMEM;
+		}
+		else
+		{
+			(*location)->latitude = stub.latitude;
+			(*location)->longitude = stub.longitude;
+		}
+	}
+	pthread_mutex_unlock(&stub.lock);
+	return rc;
+}
+
+// a token is the position it was taken at, xor'd with the key
+typedef struct
+{
+	double latitude;
+	double longitude;
+} stub_token;
+
+static void apply_key(unsigned char *data, unsigned size, const unsigned char *key, unsigned key_length)
+{
+	for (unsigned i = 0; i < size && key_length > 0; i++)
+	{
+		data[i] ^= key[i % key_length];
+	}
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_offline_token(const WPS_SimpleAuthentication *authentication, const unsigned char *key, unsigned key_length, unsigned char **token, unsigned *token_size)
+{
+	(void)authentication;
+
+	stub_token *t = malloc(sizeof(stub_token));
+	if (t == NULL)
+	{
+		return WPS_NOMEM;
+	}
+
+	pthread_mutex_lock(&stub.lock);
+	t->latitude = stub.latitude;
+	t->longitude = stub.longitude;
+	pthread_mutex_unlock(&stub.lock);
+
+	apply_key((unsigned char *)t, sizeof(*t), key, key_length);
+	*token = (unsigned char *)t;
+	*token_size = sizeof(*t);
+	return WPS_OK;
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_offline_location(const WPS_SimpleAuthentication *authentication, const unsigned char *key, unsigned key_length, const unsigned char *token, unsigned token_size, WPS_Location **location)
+{
+	(void)authentication;
+
+	if (token_size != sizeof(stub_token))
+	{
+		return WPS_ERROR_INVALID_FILE_FORMAT;
+	}
+
+	sleep_ms(latency());
+
+	stub_token t;
+	memcpy(&t, token, sizeof(t));
+	apply_key((unsigned char *)&t, sizeof(t), key, key_length);
+
+	pthread_mutex_lock(&stub.lock);
+	WPS_ReturnCode rc = stub.loaded ? next_code(&stub.errors) : WPS_ERROR;
+	if (rc == WPS_OK)
+	{
+		*location = make_location();
+		if (*location == NULL)
+		{
+			rc = WPS_NOMEM;
+		}
+		else
+		{
+			(*location)->latitude = t.latitude;
+			(*location)->longitude = t.longitude;
+		}
+	}
+	pthread_mutex_unlock(&stub.lock);
+	return rc;
+}
+
+WPSAPI_EXPORT void WPSAPI_CALL WPS_free_offline_token(unsigned char *token)
+{
+	free(token);
+}
+
+WPSAPI_EXPORT void WPSAPI_CALL WPS_free_location(WPS_Location *location)
+{
+	free(location);
+}
+
+WPSAPI_EXPORT void WPSAPI_CALL WPS_free_ip_location(WPS_IPLocation *location)
+{
+	free(location);
+}
+
+WPSAPI_EXPORT void WPSAPI_CALL WPS_set_proxy(const char *address, int port, const char *user, const char *password)
+{
+	(void)address;
+	(void)port;
+	(void)user;
+	(void)password;
+}
+
+WPSAPI_EXPORT void WPSAPI_CALL WPS_set_server_url(const char *url)
+{
+	(void)url;
+}
+
+WPSAPI_EXPORT void WPSAPI_CALL WPS_set_user_agent(const char *ua)
+{
+	(void)ua;
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_set_local_files_path(const char **paths)
+{
+	(void)paths;
+	return WPS_OK;
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_set_tier2_area(const char *dirpath, unsigned size)
+{
+	(void)dirpath;
+	(void)size;
+	return WPS_OK;
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_set_tiling(const WPS_SimpleAuthentication *authentication, const char *dirpath, unsigned maxDataSizePerSession, unsigned maxDataSizeTotal, WPS_TilingCallback callback, void *arg)
+{
+	(void)authentication;
+	(void)maxDataSizeTotal;
+
+	if (dirpath == NULL)
+	{
+		return WPS_ERROR;
+	}
+
+	pthread_mutex_lock(&stub.lock);
+	stub.tiling_callback = callback;
+	stub.tiling_arg = arg;
+	stub.tiles_pending = maxDataSizePerSession > 0;
+	pthread_mutex_unlock(&stub.lock);
+	return WPS_OK;
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_tiling(const char *dirpath, unsigned maxDataSizePerSession, unsigned maxDataSizeTotal, WPS_TilingCallback callback, void *arg)
+{
+	return WPS_set_tiling(NULL, dirpath, maxDataSizePerSession, maxDataSizeTotal, callback, arg);
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_tune_location(const WPS_SimpleAuthentication *authentication, const WPS_Location *location)
+{
+	(void)authentication;
+	(void)location;
+	return WPS_OK;
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_geofence_set(const WPS_GeoFence *geofence, WPS_GeoFenceCallback callback, void *arg, WPS_GeoFenceHandle *handle)
+{
+	if (geofence == NULL || geofence->size != sizeof(WPS_GeoFence) || callback == NULL)
+	{
+		return WPS_GEOFENCE_ERROR;
+	}
+
+	WPS_ReturnCode rc = WPS_GEOFENCE_ERROR;
+	pthread_mutex_lock(&stub.lock);
+	for (intptr_t i = 0; i < MAX_FENCES; i++)
+	{
+		if (!stub.fences[i].used)
+		{
+			stub.fences[i].used = 1;
+			stub.fences[i].geofence = *geofence;
+			stub.fences[i].callback = callback;
+			stub.fences[i].arg = arg;
+			stub.fences[i].inside = -1;
+			*handle = (WPS_GeoFenceHandle)(i + 1);
+			rc = WPS_OK;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&stub.lock);
+	return rc;
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_geofence_cancel(WPS_GeoFenceHandle handle)
+{
+	intptr_t i = (intptr_t)handle - 1;
+	if (i < 0 || i >= MAX_FENCES)
+	{
+		return WPS_GEOFENCE_ERROR;
+	}
+
+	pthread_mutex_lock(&stub.lock);
+	WPS_ReturnCode rc = stub.fences[i].used ? WPS_OK : WPS_GEOFENCE_ERROR;
+	stub.fences[i].used = 0;
+	pthread_mutex_unlock(&stub.lock);
+	return rc;
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_geofence_cancel_all()
+{
+	pthread_mutex_lock(&stub.lock);
+	memset(stub.fences, 0, sizeof(stub.fences));
+	pthread_mutex_unlock(&stub.lock);
+	return WPS_OK;
+}
+
+WPSAPI_EXPORT WPS_ReturnCode WPSAPI_CALL WPS_set_tunable(const char *key, const char *value)
+{
+	(void)key;
+	(void)value;
+	return WPS_OK;
+}
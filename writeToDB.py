@@ -1,22 +1,123 @@
-import influxdb_client
-from influxdb_client.client.write_api import SYNCHRONOUS
+import atexit
+import ctypes
+import os
+import sys
 import constants as C
+import influx
 
-def write(climate_variable, value):
+# readings are geotagged with the latest fix libgetloc published (see skyhook.py), when there is one
+try:
+    from getloc import Fix, lib as getloc
+except OSError:
+    getloc = None
 
-    bucket = C.influxdb_bucket
-    org = C.influxdb_org
-    token = C.influxdb_token
-    url = C.influxdb_url
+# older fixes say more about where the unit was than where the reading was taken
+MAX_GEOTAG_AGE_MS = 15 * 60 * 1000
 
-    client = influxdb_client.InfluxDBClient(
-        url=url,
-        token=token,
-        org=org
-    )
+fix = Fix() if getloc else None
 
-    write_api = client.write_api(write_options=SYNCHRONOUS)
-    
-    p = influxdb_client.Point("measurement").tag("location", "Hyderabad").field(
-        climate_variable, value)
-    write_api.write(bucket=bucket, org=org, record=p)
+# points are encoded to line protocol natively, the series (measurement and tags) is escaped once here
+series = influx.Series()
+if influx.lib.influx_series_init(series, b"measurement", (ctypes.c_char_p * 3)(b"location", b"Hyderabad", None)) != influx.OK:
+    raise RuntimeError("could not set up the InfluxDB series")
+
+# one writer for the whole process: points are batched and sent over a single keep-alive connection
+# by its flush thread, so write() never waits for the network (see "Batched writer" in influxpl/influx.h)
+BATCH_BYTES = 64 * 1024
+FLUSH_MS = 1000
+
+writer = influx.lib.influx_writer_open(C.influxdb_url.encode(), C.influxdb_org.encode(), C.influxdb_bucket.encode(), C.influxdb_token.encode(), BATCH_BYTES, FLUSH_MS)
+if not writer:
+    raise RuntimeError("could not open the InfluxDB writer")
+
+# every point is spooled to disk before it is sent, so readings taken while the server is unreachable (or the
+# process or the power goes away) are sent once it is back, oldest first; past SPOOL_MAX_BYTES the oldest are dropped.
+# dht.py, geiger.py and skyhook.py each have a spool of their own, one process can't append to another's
+SPOOL_ROOT = "influxpl/points.spool"
+SPOOL_PATH = os.path.join(SPOOL_ROOT, os.path.splitext(os.path.basename(sys.argv[0]))[0] or "python").encode()
+os.makedirs(SPOOL_ROOT, exist_ok=True)
+SPOOL_SEGMENT_BYTES = 1024 * 1024
+SPOOL_MAX_BYTES = 64 * 1024 * 1024
+if influx.lib.influx_writer_spool(writer, SPOOL_PATH, SPOOL_SEGMENT_BYTES, SPOOL_MAX_BYTES) != influx.OK:
+    print("could not open the InfluxDB spool, readings will be lost while the server is unreachable")
+atexit.register(influx.lib.influx_writer_close, writer)
+
+# live readings are rolled up per minute, quarter and hour before they go out (see "Rollups" in influxpl/influx.h),
+# and the raw readings themselves only once every UPLOAD_RAW_MS (0 uploads rollups only)
+ROLLUP_WINDOWS = (60, 15 * 60, 60 * 60)
+UPLOAD_RAW_MS = 60 * 1000
+rollup = influx.lib.influx_rollup_open(writer, b"measurement", (ctypes.c_char_p * 3)(b"location", b"Hyderabad", None), (ctypes.c_uint * len(ROLLUP_WINDOWS))(*ROLLUP_WINDOWS), len(ROLLUP_WINDOWS), UPLOAD_RAW_MS)
+if not rollup:
+    raise RuntimeError("could not set up the rollups")
+# a DHT11 reports whole degrees and percent, so its raw readings only go out when they change (or every
+# 10 minutes if they don't) instead of at UPLOAD_RAW_MS, which loses nothing (see "Compression" in influxpl/influx.h)
+COMPRESSION = {"temp": (influx.DEADBAND, 0.5, 10 * 60 * 1000), "humid": (influx.DEADBAND, 0.5, 10 * 60 * 1000)}
+for channel, (mode, tolerance, heartbeat_ms) in COMPRESSION.items():
+    influx.lib.influx_rollup_compress(rollup, channel.encode(), mode, tolerance, heartbeat_ms)
+# the geotag says where a reading was taken, averaging it would be meaningless and use up channels
+GEOTAG = (b"latitude", b"longitude", b"hpe")
+for key in GEOTAG:
+    influx.lib.influx_rollup_passthrough(rollup, key)
+# registered after the writer's close, so it runs before it and the open windows still go out
+atexit.register(influx.lib.influx_rollup_close, rollup)
+
+# every field is also kept on the unit, one compressed store per channel (see "On-device store" in influxpl/influx.h),
+# so history can be looked at without the server (see history.py)
+HISTORY_PATH = "influxpl/history"
+HISTORY_BLOCKS = 512  # 2 MB per channel, a few weeks of a reading every few seconds
+stores = {}
+
+def store(channel):
+    if channel not in stores:
+        os.makedirs(HISTORY_PATH, exist_ok=True)
+        stores[channel] = influx.lib.influx_store_open(os.path.join(HISTORY_PATH, channel + ".tsdb").encode(), HISTORY_BLOCKS)
+        if not stores[channel]:
+            print(f"could not open the local history of {channel}")
+        else:
+            atexit.register(influx.lib.influx_store_close, stores[channel])
+    return stores[channel]
+
+def now_ns():
+    # the time to stamp a reading with, take it when the sensor is sampled (see influx_now_ns() in influxpl/influx.h)
+    return influx.lib.influx_now_ns()
+
+def write_fields(fields, timestamp_ns=None, live=True):
+    # one point for everything read at one instant, e.g. write_fields({"humid": humidity, "temp": temperature}, sampled);
+    # live readings are geotagged and rolled up, others (back-filled or already smoothed) are written as they are
+
+    keys = [name.encode() for name in fields]
+    values = list(fields.values())
+
+    # coordinates are fields rather than tags, a tag per position would explode the series cardinality
+    if live and getloc and getloc.getloc_latest(None, fix) == 0 and fix.age <= MAX_GEOTAG_AGE_MS:
+        keys += GEOTAG
+        values += [fix.latitude, fix.longitude, fix.hpe]
+
+    # python ints stay integer fields, as influxdb_client.Point wrote them
+    integers = sum(1 << i for i, v in enumerate(values) if isinstance(v, int) and not isinstance(v, bool))
+
+    # the server would only see a point when its batch arrives, so an unstamped one is stamped now
+    if timestamp_ns is None:
+        timestamp_ns = now_ns()
+
+    for channel, value in fields.items():
+        if store(channel):
+            influx.lib.influx_store_append(stores[channel], timestamp_ns // 1000000, value)
+
+    keys = (ctypes.c_char_p * len(keys))(*keys)
+    values = (ctypes.c_double * len(values))(*values)
+    if live:
+        rc = influx.lib.influx_rollup_point(rollup, keys, values, integers, len(keys), timestamp_ns)
+    else:
+        rc = influx.lib.influx_writer_point(writer, series, keys, values, integers, len(keys), timestamp_ns)
+
+    # without the spool, a full batch means the server has been out of reach for a while; the point is dropped and counted
+    if rc == influx.INVALID:
+        raise ValueError(f"could not encode {fields}")
+
+def write(climate_variable, value, timestamp_ms=None):
+    # back-filled values (e.g. resolved offline locations) carry the time they were observed
+    if timestamp_ms is None:
+        write_fields({climate_variable: value})
+    else:
+        write_fields({climate_variable: value}, timestamp_ms * 1000000, live=False)